@@ -0,0 +1,18 @@
+#include "datavis/common.hpp"
+#include "datavis/graph_binary.hpp"
+#include "datavis/graphml.hpp"
+
+#include <fstream>
+
+int main(int argc, char** argv) {
+  VERIFY(argc == 3);
+  auto g = datavis::ParseGraphMLFile(argv[1]);
+  std::ofstream out(argv[2], std::ios::binary);
+  VERIFY(out.is_open());
+  datavis::WriteGraphBinary(g, out);
+  out.close();
+  VERIFY(!out.fail());
+  // The apps only check the size of a binary graph, so it is checked in full
+  // once, as written.
+  datavis::LoadGraphBinary(argv[2], true);
+}
@@ -1,38 +1,34 @@
 #include <datavis/common.hpp>
+#include <datavis/graph_binary.hpp>
 #include <datavis/graphml.hpp>
+#include <datavis/options.hpp>
+#include <datavis/output.hpp>
 #include <datavis/svg.hpp>
 #include <alglib/optimization.h>
 
 #include <algorithm>
-#include <fstream>
-#include <memory>
+#include <limits>
+#include <utility>
 
 
-datavis::Graph LoadGraph(const std::string& path) {
-  std::ifstream input(path);
-  VERIFY(input.is_open());
-  return datavis::ParseGraphML(input);
-}
-
 class DAG {
  public:
+  // Graph nodes come first, dummy nodes of long edges are appended after them.
   struct Node {
-    std::vector<Node*> in, out;
     int layer, pos;
     bool dummy{false};
+    int next{-1};  // The only successor of a dummy node.
   };
 
-  explicit DAG(datavis::Graph g) {
-    nodes_.resize(g.num_nodes);
-    for (auto [source, target] : g.edges) {
-      nodes_[source].out.push_back(&nodes_[target]);
-      nodes_[target].in.push_back(&nodes_[source]);
-    }
-    poses_.resize(nodes_.size(), 0);
+  explicit DAG(datavis::Graph g)
+      : graph_(std::move(g)),
+        nodes_(graph_.num_nodes),
+        first_hop_(graph_.out.Targets(), graph_.out.Targets() + graph_.num_edges),
+        poses_(nodes_.size(), 0) {
   }
 
   void CoffmanGrahem(int w) {
-    int n = static_cast<int>(nodes_.size());
+    int n = graph_.num_nodes;
     std::vector<int> label(n);
     std::vector<std::vector<int>> parent_labels(n);
 
@@ -55,7 +51,7 @@ class DAG {
       std::vector<int> heap;
       heap.reserve(n);
       for (int i = 0; i < n; ++i) {
-        if (nodes_[i].in.empty()) {
+        if (graph_.in[i].empty()) {
           heap.push_back(i);
           std::push_heap(heap.begin(), heap.end(), comparer);
         }
@@ -66,10 +62,9 @@ class DAG {
         int v = heap.back();
         heap.pop_back();
         label[v] = i;
-        for (auto *nxt : nodes_[v].out) {
-          int u = GetId(nxt);
+        for (int u : graph_.out[v]) {
           parent_labels[u].push_back(i);
-          if (parent_labels[u].size() == nxt->in.size()) {
+          if (parent_labels[u].size() == graph_.in.Degree(u)) {
             heap.push_back(u);
             std::push_heap(heap.begin(), heap.end(), comparer);
           }
@@ -83,7 +78,7 @@ class DAG {
       std::vector<int> num_nxt_placed(n);
       heap.reserve(n);
       for (int i = 0; i < n; ++i) {
-        if (nodes_[i].out.empty()) {
+        if (graph_.out[i].empty()) {
           heap.emplace_back(label[i], i);
           std::push_heap(heap.begin(), heap.end());
         }
@@ -97,8 +92,8 @@ class DAG {
         int v = heap.back().second;
         heap.pop_back();
         bool need_new_layer = false;
-        for (auto* u : nodes_[v].out) {
-          if (u->layer == layer) {
+        for (int u : graph_.out[v]) {
+          if (nodes_[u].layer == layer) {
             need_new_layer = true;
             break;
           }
@@ -110,9 +105,8 @@ class DAG {
         nodes_[v].layer = layer;
         nodes_[v].pos = pos[layer]++;
         ++cnt;
-        for (auto* prv : nodes_[v].in) {
-          int u = GetId(prv);
-          if (++num_nxt_placed[u] == prv->out.size()) {
+        for (int u : graph_.in[v]) {
+          if (++num_nxt_placed[u] == graph_.out.Degree(u)) {
             heap.emplace_back(label[u], u);
             std::push_heap(heap.begin(), heap.end());
           }
@@ -126,41 +120,63 @@ class DAG {
     AddDummies();
   }
 
-  void Save(const char* file) const {
-    std::ofstream out(file);
-    VERIFY(out.is_open());
-    datavis::SvgImage image;
-    for (auto& v : nodes_) {
-      for (auto* nxt : v.out) {
-        image.lines.push_back({{
-          static_cast<double>(v.pos),
-          static_cast<double>(v.layer)
-          }, {
-          static_cast<double>(nxt->pos), static_cast<double>(nxt->layer)
-          }, !nxt->dummy});
+  void Save(const char* file, const datavis::Options& options) const {
+    auto point = [](const Node& v) {
+      return datavis::Point{static_cast<double>(v.pos), static_cast<double>(v.layer)};
+    };
+    int n = graph_.num_nodes;
+    if (auto layout = datavis::OpenLayout(file, n, graph_.num_edges)) {
+      for (int v = 0; v < n; ++v) {
+        layout->AddNode(v, point(nodes_[v]));
+      }
+      std::vector<datavis::Point> bends;
+      for (int v = 0; v < n; ++v) {
+        for (auto i = graph_.out.Offsets()[v]; i < graph_.out.Offsets()[v + 1]; ++i) {
+          bends.clear();
+          int nxt = first_hop_[i];
+          for (; nodes_[nxt].dummy; nxt = nodes_[nxt].next) {
+            bends.push_back(point(nodes_[nxt]));
+          }
+          layout->AddEdge(v, nxt, bends);
+        }
       }
+      layout->End();
+      return;
     }
-    for (auto& v : dummy_nodes_) {
-      for (auto* nxt : v->out) {
-        image.lines.push_back({{
-                                   static_cast<double>(v->pos),
-                                   static_cast<double>(v->layer)
-                               }, {
-                                   static_cast<double>(nxt->pos), static_cast<double>(nxt->layer)
-                               }, !nxt->dummy});
+
+    datavis::SvgImage settings;
+    datavis::ApplyOptions(options, settings);
+    auto inf = std::numeric_limits<double>::infinity();
+    datavis::Box bounds{{inf, inf}, {-inf, -inf}};
+    for (const auto& node : nodes_) {
+      auto p = point(node);
+      bounds.min = {std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y)};
+      bounds.max = {std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y)};
+    }
+    auto drawing = datavis::OpenDrawing(file, settings, options);
+    drawing->Begin(bounds, graph_.num_edges > 0);
+    auto add_line = [&](const Node& v, const Node& nxt) {
+      drawing->AddLine({point(v), point(nxt), !nxt.dummy});
+    };
+    for (int v = 0; v < n; ++v) {
+      for (auto i = graph_.out.Offsets()[v]; i < graph_.out.Offsets()[v + 1]; ++i) {
+        add_line(nodes_[v], nodes_[first_hop_[i]]);
       }
     }
-    for (const auto& v : nodes_) {
-      image.circles.push_back({{static_cast<double>(v.pos), static_cast<double>(v.layer)}});
+    for (size_t v = n; v < nodes_.size(); ++v) {
+      add_line(nodes_[v], nodes_[nodes_[v].next]);
     }
-    image.Write(out);
+    for (int v = 0; v < n; ++v) {
+      drawing->AddCircle({point(nodes_[v])});
+    }
+    drawing->End();
   }
 
   void MinimizeDummyNodes() {
     alglib::minlpstate state;
     // Last dimension is constant
     alglib::minlpcreate(static_cast<long>(nodes_.size()), state);
-    int n = static_cast<int>(nodes_.size());
+    int n = graph_.num_nodes;
     {
       alglib::real_1d_array cost;
       cost.setlength(n);
@@ -168,13 +184,13 @@ class DAG {
         cost[i] = 0;
       }
       for (int i = 0; i < n; ++i) {
-        for (auto* j : nodes_[i].out) {
-          cost[GetId(j)] += 1;
+        for (int j : graph_.out[i]) {
+          cost[j] += 1;
           cost[i] -= 1;
           alglib::integer_1d_array idx;
           idx.setlength(2);
           idx[0] = i;
-          idx[1] = GetId(j);
+          idx[1] = j;
           alglib::real_1d_array coef;
           coef.setlength(2);
           coef[0] = -1;
@@ -205,12 +221,9 @@ class DAG {
   }
 
  private:
-  int GetId(Node* v) {
-    return static_cast<int>(v - nodes_.data());
-  }
-
-  Node* CreateDummy() {
-    return dummy_nodes_.emplace_back(std::make_unique<Node>()).get();
+  int CreateDummy() {
+    nodes_.emplace_back().dummy = true;
+    return static_cast<int>(nodes_.size()) - 1;
   }
 
   void InvertLayers() {
@@ -224,16 +237,16 @@ class DAG {
   }
 
   void AddDummies() {
-    int n = static_cast<int>(nodes_.size());
+    int n = graph_.num_nodes;
     for (int v = 0; v < n; ++v) {
-      for (auto &nxt : nodes_[v].out) {
-        int nxt_layer = nxt->layer;
+      for (auto i = graph_.out.Offsets()[v]; i < graph_.out.Offsets()[v + 1]; ++i) {
+        int& nxt = first_hop_[i];
+        int nxt_layer = nodes_[nxt].layer;
         for (int dummy_layer = nxt_layer + 1; dummy_layer < nodes_[v].layer; ++dummy_layer) {
-          auto dummy = CreateDummy();
-          dummy->layer = dummy_layer;
-          dummy->dummy = true;
-          dummy->pos = poses_[dummy_layer]++;
-          dummy->out = {nxt};
+          int dummy = CreateDummy();
+          nodes_[dummy].layer = dummy_layer;
+          nodes_[dummy].pos = poses_[dummy_layer]++;
+          nodes_[dummy].next = nxt;
           nxt = dummy;
         }
       }
@@ -241,18 +254,21 @@ class DAG {
   }
 
  private:
+  const datavis::Graph graph_;
   std::vector<Node> nodes_;
+  // Per edge of `graph_.out`: its target or the first dummy node on the way to it.
+  std::vector<int> first_hop_;
   std::vector<int> poses_;
-  std::vector<std::unique_ptr<Node>> dummy_nodes_;
 };
 
 int main(int argc, char** argv) {
+  datavis::Options options(argc, argv);
   VERIFY(argc == 4 || argc == 3);
-  DAG g(LoadGraph(argv[1]));
+  DAG g(datavis::LoadGraph(argv[1], 0, options.Has("check-graph")));
   if (argc == 4) {
     g.CoffmanGrahem(std::stoi(argv[3]));
   } else {
     g.MinimizeDummyNodes();
   }
-  g.Save(argv[2]);
+  g.Save(argv[2], options);
 }
@@ -1,4 +1,6 @@
 #include "datavis/common.hpp"
+#include "datavis/options.hpp"
+#include "datavis/output.hpp"
 #include "datavis/svg.hpp"
 
 #include <iostream>
@@ -171,6 +173,7 @@ bool Intersects(const Rectangle& a, const Rectangle& b) {
 }
 
 int main(int argc, char* argv[]) {
+  datavis::Options options(argc, argv);
   VERIFY(argc == 3);
   auto labels = ReadInput(argv[1]);
   std::vector<std::pair<int, int>> rules;
@@ -198,15 +201,25 @@ int main(int argc, char* argv[]) {
   std::cout << std::boolalpha;
   int idx = 0;
 
-  datavis::SvgImage image;
-  image.fixed_size = {kSide, kSide};
-  image.scale = {1, 1};
-  for (auto x : Solve2Sat(n, rules)) {
+  auto choice = Solve2Sat(n, rules);
+  if (auto layout = datavis::OpenLayout(argv[2], n, 0)) {
+    for (auto x : choice) {
+      auto& rect = labels[idx][!x];
+      layout->AddNode(idx++, {double(rect.x), double(rect.y)});
+    }
+    layout->End();
+    return 0;
+  }
+
+  datavis::SvgImage settings;
+  settings.fixed_size = {kSide, kSide};
+  settings.scale = {1, 1};
+  datavis::ApplyOptions(options, settings);
+  auto drawing = datavis::OpenDrawing(argv[2], settings, options);
+  drawing->Begin({{0, 0}, {kSide, kSide}}, false);
+  for (auto x : choice) {
     auto& rect = labels[idx++][!x];
-    image.rects.push_back(datavis::SvgImage::Rect{
-      {double(rect.x), double(rect.y)},
-      {double(rect.width), double(rect.height)}});
+    drawing->AddRect({{double(rect.x), double(rect.y)}, {double(rect.width), double(rect.height)}});
   }
-  std::ofstream result(argv[2]);
-  image.Write(result);
+  drawing->End();
 }
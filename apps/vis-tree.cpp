@@ -1,69 +1,502 @@
 #include "datavis/common.hpp"
+#include "datavis/flat_tree.hpp"
+#include "datavis/graph_binary.hpp"
 #include "datavis/graphml.hpp"
+#include "datavis/options.hpp"
+#include "datavis/output.hpp"
+#include "datavis/parallel.hpp"
 #include "datavis/svg.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
-#include <unordered_set>
+#include <limits>
+#include <unordered_map>
 #include <vector>
 
-struct Node {
-  std::vector<Node*> children;
-  double leftmost_x;
-  double rightmost_x;
-  double x;
-  double y;
-};
+// Width of every subtree of the pre-order range [begin, end), a whole
+// subtree, from its leftmost to its rightmost leaf. In the reverse sweep a
+// node's width holds the widths of its children plus the gaps after them
+// until the node is reached.
+void SweepWidths(const datavis::FlatTree& tree, int begin, int end, std::vector<double>& width) {
+  for (int i = end; i-- > begin;) {
+    width[i] = width[i] > 0 ? width[i] - 2 : 0;
+    if (i > begin) {
+      width[tree.parent[i]] += width[i] + 2;
+    }
+  }
+}
+
+// Positions below the root of the range, whose `cursor`, the left edge of
+// its next child, is set: children take the next 2 + width units in turn.
+void SweepPositions(const datavis::FlatTree& tree, int begin, int end, const std::vector<double>& width,
+                    std::vector<double>& cursor, std::vector<datavis::Point>& nodes) {
+  for (int i = begin + 1; i < end; ++i) {
+    auto& parent_cursor = cursor[tree.parent[i]];
+    auto left = parent_cursor;
+    parent_cursor += width[i] + 2;
+    cursor[i] = left;
+    nodes[tree.id[i]] = {left + width[i] / 2, static_cast<double>(tree.depth[i])};
+  }
+}
+
+// Default placement: leaves 2 apart in DFS order, every node centred over the
+// leaves of its subtree at its depth, the leftmost leaf at 0. Only the nodes
+// of the tree are written to `nodes`. Both passes are sweeps over the
+// pre-order. With several threads the tree is cut below the first level with
+// enough nodes to keep them busy, and the subtrees hanging from that level,
+// ranges of the pre-order, are swept in parallel; the nodes above get their
+// widths bottom-up and their offsets top-down as prefix sums over the sibling
+// widths in between. The result does not depend on the threads.
+void CalculateTreePlacement(const datavis::FlatTree& tree, int num_threads, std::vector<datavis::Point>& nodes) {
+  std::vector<double> width(tree.NumNodes(), 0);
+  std::vector<double> cursor(tree.NumNodes(), 0);
+
+  std::vector<int> top;
+  std::vector<int> frontier{0};
+  auto threads = static_cast<size_t>(datavis::NumThreads(num_threads));
+  while (threads > 1 && !frontier.empty() && frontier.size() < 16 * threads) {
+    std::vector<int> next;
+    for (int v : frontier) {
+      top.push_back(v);
+      for (int child = tree.FirstChild(v); child >= 0; child = tree.NextSibling(child)) {
+        next.push_back(child);
+      }
+    }
+    frontier = std::move(next);
+  }
+
+  datavis::ParallelFor(frontier.size(), num_threads, [&](size_t i) {
+    int subtree_root = frontier[i];
+    SweepWidths(tree, subtree_root, subtree_root + tree.size[subtree_root], width);
+  });
+  // Top nodes are in BFS order, so children come after their parent.
+  for (auto it = top.rbegin(); it != top.rend(); ++it) {
+    for (int child = tree.FirstChild(*it); child >= 0; child = tree.NextSibling(child)) {
+      width[*it] += width[child] + 2;
+    }
+    width[*it] = width[*it] > 0 ? width[*it] - 2 : 0;
+  }
+
+  nodes[tree.id[0]] = {width[0] / 2, 0};
+  for (int v : top) {
+    for (int child = tree.FirstChild(v); child >= 0; child = tree.NextSibling(child)) {
+      cursor[child] = cursor[v];
+      cursor[v] += width[child] + 2;
+      nodes[tree.id[child]] = {cursor[child] + width[child] / 2, static_cast<double>(tree.depth[child])};
+    }
+  }
+  datavis::ParallelFor(frontier.size(), num_threads, [&](size_t i) {
+    int subtree_root = frontier[i];
+    SweepPositions(tree, subtree_root, subtree_root + tree.size[subtree_root], width, cursor, nodes);
+  });
+}
+
+// Tidy layout of Buchheim, Juenger and Leipert, "Improving Walker's
+// algorithm to run in linear time": subtrees are pushed together as far as
+// their contours allow, keeping nodes of a level at least `kDistance` apart,
+// the leftmost node at 0. Contours are followed through threads. The first
+// walk is a post-order sweep, the second a pre-order one; nodes are
+// positions in the pre-order.
+void CalculateTidyPlacement(const datavis::FlatTree& tree, std::vector<datavis::Point>& nodes) {
+  constexpr double kDistance = 2;
+  constexpr int kNone = -1;
+  struct State {
+    double prelim{0};
+    double mod{0};
+    double shift{0};
+    double change{0};
+    int thread{kNone};
+    int ancestor{0};
+    int previous{kNone};    // Left sibling.
+    int last_child{kNone};
+    int number{0};  // Index among the siblings.
+  };
+  int n = tree.NumNodes();
+  std::vector<State> state(n);
+  for (int v = 0; v < n; ++v) {
+    state[v].ancestor = v;
+    if (int p = tree.parent[v]; p != kNone) {
+      if (int previous = state[p].last_child; previous != kNone) {
+        state[v].previous = previous;
+        state[v].number = state[previous].number + 1;
+      }
+      state[p].last_child = v;
+    }
+  }
+
+  auto next_left = [&](int v) { return state[v].last_child != kNone ? v + 1 : state[v].thread; };
+  auto next_right = [&](int v) { return state[v].last_child != kNone ? state[v].last_child : state[v].thread; };
+  auto move_subtree = [&](int left, int right, double shift) {
+    auto subtrees = state[right].number - state[left].number;
+    state[right].change -= shift / subtrees;
+    state[right].shift += shift;
+    state[left].change += shift / subtrees;
+    state[right].prelim += shift;
+    state[right].mod += shift;
+  };
+  // Resolves the conflict of v with its left siblings; `default_ancestor` is
+  // that of the parent of v.
+  auto apportion = [&](int v, int& default_ancestor) {
+    if (state[v].number == 0) {
+      return;
+    }
+    int inner_right = v;
+    int outer_right = v;
+    int inner_left = state[v].previous;
+    int outer_left = tree.parent[v] + 1;
+    double s_inner_right = state[inner_right].mod;
+    double s_outer_right = state[outer_right].mod;
+    double s_inner_left = state[inner_left].mod;
+    double s_outer_left = state[outer_left].mod;
+    while (next_right(inner_left) != kNone && next_left(inner_right) != kNone) {
+      inner_left = next_right(inner_left);
+      inner_right = next_left(inner_right);
+      outer_left = next_left(outer_left);
+      outer_right = next_right(outer_right);
+      state[outer_right].ancestor = v;
+      auto shift = (state[inner_left].prelim + s_inner_left) - (state[inner_right].prelim + s_inner_right) + kDistance;
+      if (shift > 0) {
+        int ancestor = state[inner_left].ancestor;
+        if (tree.parent[ancestor] != tree.parent[v]) {
+          ancestor = default_ancestor;
+        }
+        move_subtree(ancestor, v, shift);
+        s_inner_right += shift;
+        s_outer_right += shift;
+      }
+      s_inner_left += state[inner_left].mod;
+      s_inner_right += state[inner_right].mod;
+      s_outer_left += state[outer_left].mod;
+      s_outer_right += state[outer_right].mod;
+    }
+    if (next_right(inner_left) != kNone && next_right(outer_right) == kNone) {
+      state[outer_right].thread = next_right(inner_left);
+      state[outer_right].mod += s_inner_left - s_outer_right;
+    }
+    if (next_left(inner_right) != kNone && next_left(outer_left) == kNone) {
+      state[outer_left].thread = next_left(inner_right);
+      state[outer_left].mod += s_inner_right - s_outer_left;
+      default_ancestor = v;
+    }
+  };
+
+  // First walk: preliminary x relative to the parent. A node is finished
+  // when the sweep leaves its subtree, which gives the post-order.
+  std::vector<int> default_ancestor(n, kNone);
+  auto finish = [&](int v) {
+    auto& current = state[v];
+    double left_prelim = current.previous != kNone ? state[current.previous].prelim : 0;
+    if (current.last_child == kNone) {
+      current.prelim = current.number > 0 ? left_prelim + kDistance : 0;
+    } else {
+      double shift = 0;
+      double change = 0;
+      for (int child = current.last_child; child != kNone; child = state[child].previous) {
+        state[child].prelim += shift;
+        state[child].mod += shift;
+        change += state[child].change;
+        shift += state[child].shift + change;
+      }
+      auto midpoint = (state[v + 1].prelim + state[current.last_child].prelim) / 2;
+      if (current.number > 0) {
+        current.prelim = left_prelim + kDistance;
+        current.mod = current.prelim - midpoint;
+      } else {
+        current.prelim = midpoint;
+      }
+    }
+    if (int p = tree.parent[v]; p != kNone) {
+      if (current.number == 0) {
+        default_ancestor[p] = v;
+      }
+      apportion(v, default_ancestor[p]);
+    }
+  };
+  std::vector<int> open;
+  for (int i = 0; i <= n; ++i) {
+    while (!open.empty() && (i == n || i >= open.back() + tree.size[open.back()])) {
+      finish(open.back());
+      open.pop_back();
+    }
+    if (i < n) {
+      open.push_back(i);
+    }
+  }
+
+  // Second walk: x is prelim plus the modifiers of the ancestors.
+  std::vector<double> modifiers(n, 0);
+  std::vector<double> x(n);
+  double min_x = std::numeric_limits<double>::infinity();
+  for (int v = 0; v < n; ++v) {
+    if (int p = tree.parent[v]; p != kNone) {
+      modifiers[v] = modifiers[p] + state[p].mod;
+    }
+    x[v] = state[v].prelim + modifiers[v];
+    min_x = std::min(min_x, x[v]);
+  }
+  for (int v = 0; v < n; ++v) {
+    nodes[tree.id[v]] = {x[v] - min_x, static_cast<double>(tree.depth[v])};
+  }
+}
 
-void CalculateTreePlacement(Node& node, double x_offset = 0, double level = 0) {
-  node.y = level;
-  node.leftmost_x = x_offset;
-  if (node.children.empty()) {
-    node.rightmost_x = x_offset;
-    node.x = x_offset;
-    return;
+// Origins of trees of the given widths and heights, their leftmost nodes at
+// x = 0 and roots at y = 0, packed into one drawing without overlaps. In a
+// row the trees stand side by side in input order. On shelves the trees,
+// tallest first, fill rows of about the width that makes the drawing square,
+// a level being as tall as two units are wide, every row as tall as its
+// first tree.
+std::vector<datavis::Point> PackTrees(const std::vector<datavis::Point>& sizes, bool shelves) {
+  constexpr double kGap = 2;
+  constexpr double kLevelGap = 1;
+  std::vector<datavis::Point> origins(sizes.size());
+  if (!shelves) {
+    double x = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      origins[i] = {x, 0};
+      x += sizes[i].x + kGap;
+    }
+    return origins;
   }
 
-  for (auto* child : node.children) {
-    CalculateTreePlacement(*child, x_offset, level + 1);
-    x_offset = child->rightmost_x + 2;
+  double widest = 0;
+  double area = 0;
+  for (const auto& size : sizes) {
+    widest = std::max(widest, size.x);
+    area += (size.x + kGap) * 2 * (size.y + kLevelGap);
+  }
+  auto shelf_width = std::max(widest, std::sqrt(area));
+  std::vector<size_t> order(sizes.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a].y > sizes[b].y; });
+  double x = 0;
+  double y = 0;
+  double shelf_height = 0;
+  for (size_t i : order) {
+    if (x > 0 && x + sizes[i].x > shelf_width) {
+      x = 0;
+      y += shelf_height + kLevelGap;
+    }
+    if (x == 0) {
+      shelf_height = sizes[i].y;
+    }
+    origins[i] = {x, y};
+    x += sizes[i].x + kGap;
+  }
+  return origins;
+}
+
+// Drawing of the default placement in which equal subtrees are drawn once.
+// Subtrees get AHU canonical names: the shape of a node is the sequence of the
+// shapes of its children, so interning these sequences bottom-up gives equal
+// ids exactly to equal ordered subtrees. Every shape is laid out once, by its
+// width as CalculateTreePlacement would lay it out, and shapes with children
+// that occur more than once become symbols placed at every occurrence. The
+// trees of a forest are packed as by PackTrees.
+datavis::SvgImage DrawSharedSubtrees(const datavis::Graph& g, const std::vector<int>& roots, bool shelves) {
+  struct Shape {
+    std::vector<int> children;
+    double width{0};  // From the leftmost to the rightmost leaf.
+    double height{0};  // Depth of the deepest leaf.
+    size_t count{0};
+    int symbol{-1};
+  };
+  struct Hash {
+    size_t operator()(const std::vector<int>& ids) const {
+      uint64_t hash = ids.size();
+      for (int id : ids) {
+        hash = (hash ^ static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+      }
+      return static_cast<size_t>(hash);
+    }
+  };
+  std::unordered_map<std::vector<int>, int, Hash> ids;
+  std::vector<Shape> shapes;
+  std::vector<int> shape(g.num_nodes);
+  std::vector<std::pair<int, size_t>> stack;
+  std::vector<int> key;
+  int visited = 0;
+  for (int root : roots) {
+    stack.emplace_back(root, 0);
   }
+  while (!stack.empty()) {
+    auto [v, next_child] = stack.back();
+    auto children = g.out[v];
+    if (next_child < children.size()) {
+      ++stack.back().second;
+      stack.emplace_back(children[next_child], 0);
+      continue;
+    }
+    stack.pop_back();
+    ++visited;
+    key.clear();
+    for (int child : children) {
+      key.push_back(shape[child]);
+    }
+    auto [it, inserted] = ids.try_emplace(key, static_cast<int>(shapes.size()));
+    if (inserted) {
+      auto& added = shapes.emplace_back();
+      added.children = key;
+      for (int child : key) {
+        added.width += shapes[child].width;
+        added.height = std::max(added.height, shapes[child].height + 1);
+      }
+      if (!key.empty()) {
+        added.width += 2.0 * (key.size() - 1);
+      }
+    }
+    ++shapes[it->second].count;
+    shape[v] = it->second;
+  }
+  Verify(visited == g.num_nodes, "The graph is not a forest");
 
-  node.rightmost_x = node.children.back()->rightmost_x;
-  node.x = (node.leftmost_x + node.rightmost_x) / 2;
+  // Draws shape s rooted at `origin` into the image or a symbol, placing the
+  // symbols of its repeated subtrees.
+  auto draw = [&](auto& target, int s, datavis::Point origin) {
+    std::vector<std::pair<int, datavis::Point>> pending{{s, origin}};
+    while (!pending.empty()) {
+      auto [current, at] = pending.back();
+      pending.pop_back();
+      target.circles.push_back({at});
+      auto left = at.x - shapes[current].width / 2;
+      for (int child : shapes[current].children) {
+        datavis::Point child_at{left + shapes[child].width / 2, at.y + 1};
+        target.lines.push_back({at, child_at});
+        if (shapes[child].symbol >= 0) {
+          target.uses.push_back({static_cast<size_t>(shapes[child].symbol), child_at});
+        } else {
+          pending.emplace_back(child, child_at);
+        }
+        left += shapes[child].width + 2;
+      }
+    }
+  };
+
+  // Children have smaller shape ids, so symbols place only earlier symbols.
+  datavis::SvgImage result;
+  for (int s = 0; s < static_cast<int>(shapes.size()); ++s) {
+    if (shapes[s].count > 1 && !shapes[s].children.empty()) {
+      shapes[s].symbol = static_cast<int>(result.symbols.size());
+      draw(result.symbols.emplace_back(), s, {0, 0});
+    }
+  }
+  std::vector<datavis::Point> sizes;
+  for (int root : roots) {
+    sizes.push_back({shapes[shape[root]].width, shapes[shape[root]].height});
+  }
+  auto origins = PackTrees(sizes, shelves);
+  for (size_t i = 0; i < roots.size(); ++i) {
+    auto& root_shape = shapes[shape[roots[i]]];
+    datavis::Point at{origins[i].x + root_shape.width / 2, origins[i].y};
+    if (root_shape.symbol >= 0) {
+      result.uses.push_back({static_cast<size_t>(root_shape.symbol), at});
+    } else {
+      draw(result, shape[roots[i]], at);
+    }
+  }
+  return result;
 }
 
 int main(int argc, char** argv) {
-  datavis::Graph g;
+  datavis::Options options(argc, argv);
   VERIFY(argc == 3);
-  {
-    std::ifstream file(argv[1]);
-    VERIFY(file.is_open());
-    g = datavis::ParseGraphML(file);
+  auto g = datavis::LoadGraph(argv[1], 0, options.Has("check-graph"));
+  std::vector<int> roots;
+  for (int v = 0; v < g.num_nodes; ++v) {
+    auto in_degree = g.in.Degree(v);
+    Verify(in_degree <= 1, "The graph is not a forest");
+    if (in_degree == 0) {
+      roots.push_back(v);
+    }
   }
-  std::vector<Node> nodes(g.num_nodes);
-  std::unordered_set<int> maybe_root;
-  for (int i = 0; i < g.num_nodes; ++i) {
-    maybe_root.insert(i);
+  Verify(!roots.empty(), "The graph is not a forest");
+  auto pack = options.Get("pack", "shelf");
+  Verify(pack == "shelf" || pack == "row", "Bad value of --pack");
+  auto num_threads = options.GetInt("threads", 0);
+  if (options.Has("reuse-subtrees") && !datavis::IsLayoutPath(argv[2])) {
+    Verify(options.Get("layout", "simple") == "simple", "--reuse-subtrees needs the default layout");
+    auto image = DrawSharedSubtrees(g, roots, pack == "shelf");
+    datavis::ApplyOptions(options, image);
+    datavis::SaveImage(image, argv[2], options);
+    return 0;
   }
-  for (auto [source, target] : g.edges) {
-    maybe_root.erase(target);
-    nodes[source].children.push_back(&nodes[target]);
+
+  auto placement = options.Get("layout", "simple");
+  Verify(placement == "simple" || placement == "tidy", "Bad value of --layout");
+  std::vector<datavis::FlatTree> trees(roots.size());
+  datavis::ParallelFor(roots.size(), num_threads, [&](size_t i) { trees[i] = datavis::Flatten(g, roots[i]); });
+  size_t num_placed = 0;
+  for (const auto& tree : trees) {
+    num_placed += tree.id.size();
   }
-  VERIFY(maybe_root.size() == 1);
-  int root = *maybe_root.begin();
-  CalculateTreePlacement(nodes[root]);
+  Verify(num_placed == static_cast<size_t>(g.num_nodes), "The graph is not a forest");
 
-  std::ofstream out(argv[2]);
-  datavis::SvgImage result;
-  for (auto& node : nodes) {
-    for (auto* child : node.children) {
-      result.lines.push_back({{node.x, node.y},
-                              {child->x, child->y}});
+  // A single tree gets all the threads, a forest one thread per tree, the
+  // largest trees first.
+  std::vector<datavis::Point> nodes(g.num_nodes);
+  std::vector<datavis::Point> sizes(trees.size());
+  std::vector<size_t> order(trees.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return trees[a].NumNodes() > trees[b].NumNodes(); });
+  datavis::ParallelFor(order.size(), num_threads, [&](size_t i) {
+    const auto& tree = trees[order[i]];
+    if (placement == "tidy") {
+      CalculateTidyPlacement(tree, nodes);
+    } else {
+      CalculateTreePlacement(tree, trees.size() == 1 ? num_threads : 1, nodes);
+    }
+    auto& size = sizes[order[i]];
+    for (int v : tree.id) {
+      size = {std::max(size.x, nodes[v].x), std::max(size.y, nodes[v].y)};
+    }
+  });
+  if (trees.size() > 1) {
+    auto origins = PackTrees(sizes, pack == "shelf");
+    for (size_t i = 0; i < trees.size(); ++i) {
+      for (int v : trees[i].id) {
+        nodes[v] = {nodes[v].x + origins[i].x, nodes[v].y + origins[i].y};
+      }
     }
-    result.circles.push_back({{node.x, node.y}});
   }
-  std::ofstream result_file(argv[2]);
-  //WriteSvg(result, result_file);
-  result.Write(result_file);
+  trees.clear();
+
+  if (auto layout = datavis::OpenLayout(argv[2], g.num_nodes, g.num_edges)) {
+    for (int v = 0; v < g.num_nodes; ++v) {
+      layout->AddNode(v, {nodes[v].x, nodes[v].y});
+    }
+    for (int v = 0; v < g.num_nodes; ++v) {
+      for (int child : g.out[v]) {
+        layout->AddEdge(v, child);
+      }
+    }
+    layout->End();
+    return 0;
+  }
+
+  datavis::SvgImage settings;
+  datavis::ApplyOptions(options, settings);
+  auto inf = std::numeric_limits<double>::infinity();
+  datavis::Box bounds{{inf, inf}, {-inf, -inf}};
+  for (const auto& node : nodes) {
+    bounds.min = {std::min(bounds.min.x, node.x), std::min(bounds.min.y, node.y)};
+    bounds.max = {std::max(bounds.max.x, node.x), std::max(bounds.max.y, node.y)};
+  }
+  auto drawing = datavis::OpenDrawing(argv[2], settings, options);
+  drawing->Begin(bounds, g.num_edges > 0);
+  for (int v = 0; v < g.num_nodes; ++v) {
+    auto& node = nodes[v];
+    for (int child : g.out[v]) {
+      drawing->AddLine({{node.x, node.y}, {nodes[child].x, nodes[child].y}});
+    }
+  }
+  for (const auto& node : nodes) {
+    drawing->AddCircle({{node.x, node.y}});
+  }
+  drawing->End();
 }
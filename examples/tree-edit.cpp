@@ -0,0 +1,106 @@
+// Random subtree insertions and removals on the tree of a graph, laid out
+// with TreeLayout. Every tenth of the way the positions are checked against a
+// layout built from scratch, and at the end the time per edit is compared
+// with the time of such a rebuild:
+//   tree-edit data/tree/full_binary.xml --edits=100000 --seed=1
+#include "datavis/common.hpp"
+#include "datavis/graph_binary.hpp"
+#include "datavis/options.hpp"
+#include "datavis/tree_layout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// The current tree as a graph, nodes numbered breadth-first from the root.
+datavis::Graph CurrentTree(const datavis::TreeLayout& layout, std::vector<int>& ids) {
+  ids.assign(1, layout.Root());
+  std::vector<datavis::Graph::Edge> edges;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    for (int child : layout.Children(ids[i])) {
+      edges.push_back({static_cast<int>(i), static_cast<int>(ids.size())});
+      ids.push_back(child);
+    }
+  }
+  return datavis::Graph::FromEdges(static_cast<int>(ids.size()), edges);
+}
+
+// Time of a layout from scratch; throws if its positions differ.
+Clock::duration CheckAgainstRebuild(const datavis::TreeLayout& layout) {
+  std::vector<int> ids;
+  auto tree = CurrentTree(layout, ids);
+  auto start = Clock::now();
+  datavis::TreeLayout rebuilt(tree, 0);
+  auto expected = rebuilt.Positions();
+  auto elapsed = Clock::now() - start;
+  auto actual = layout.Positions();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    Verify(actual[ids[i]].x == expected[i].x && actual[ids[i]].y == expected[i].y,
+           "Position of node " + std::to_string(ids[i]) + " differs from the rebuilt layout");
+  }
+  return elapsed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  datavis::Options options(argc, argv);
+  VERIFY(argc == 2);
+  auto g = datavis::LoadGraph(argv[1]);
+  std::vector<int> roots;
+  for (int v = 0; v < g.num_nodes; ++v) {
+    if (g.in.Degree(v) == 0) {
+      roots.push_back(v);
+    }
+  }
+  Verify(roots.size() == 1, "The graph is not a tree");
+  auto num_edits = options.GetInt("edits", 10000);
+  Verify(num_edits > 0, "Bad value of --edits");
+  std::mt19937 engine(static_cast<uint32_t>(options.GetInt("seed", 1)));
+
+  datavis::TreeLayout layout(g, roots[0]);
+  auto random_node = [&] {
+    while (true) {
+      int v = std::uniform_int_distribution<int>(0, layout.NumIds() - 1)(engine);
+      if (layout.Contains(v)) {
+        return v;
+      }
+    }
+  };
+  Clock::duration editing{};
+  Clock::duration rebuilding{};
+  int num_rebuilds = 0;
+  for (int edit = 1; edit <= num_edits; ++edit) {
+    // Inserts copy a random subtree of the input, which costs its size on top
+    // of the update.
+    int v = random_node();
+    auto start = Clock::now();
+    if (v != layout.Root() && engine() % 2 == 0) {
+      layout.Remove(v);
+    } else {
+      auto index = engine() % (layout.Children(v).size() + 1);
+      layout.Insert(v, index, g, std::uniform_int_distribution<int>(0, g.num_nodes - 1)(engine));
+    }
+    editing += Clock::now() - start;
+    if (edit % std::max(num_edits / 10, 1) == 0) {
+      rebuilding += CheckAgainstRebuild(layout);
+      ++num_rebuilds;
+    }
+  }
+
+  std::vector<int> ids;
+  CurrentTree(layout, ids);
+  std::cout << num_edits << " edits, " << g.num_nodes << " -> " << ids.size() << " nodes\n"
+            << Microseconds(editing) / num_edits << " us per edit\n"
+            << Microseconds(rebuilding) / num_rebuilds << " us per rebuild\n";
+}
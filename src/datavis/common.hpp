@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 inline void Verify(bool expr, const char* msg) {
@@ -18,3 +20,12 @@ inline void Verify(bool expr, const std::string& msg) {
 #define STRINGIFY_IMPL(x) #x
 
 #define VERIFY(expr) Verify((expr), __FILE__ ":" STRINGIFY(__LINE__) ": Verification failed: \"" #expr "\"")
+
+// The binary formats are native little-endian, so they are only written and
+// read on such machines.
+inline bool IsLittleEndian() {
+  uint32_t one = 1;
+  char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
@@ -0,0 +1,63 @@
+#include "drawing.hpp"
+
+#include "common.hpp"
+
+#include <ostream>
+
+namespace datavis {
+
+namespace {
+
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFlushSize = 1 << 20;
+
+}  // namespace
+
+BinaryDrawingSink::BinaryDrawingSink(std::ostream& out) : out_(out) {
+  VERIFY(IsLittleEndian());
+}
+
+void BinaryDrawingSink::Begin(const Box& bounds, bool) {
+  buffer_ += "DVDW";
+  buffer_.append(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  for (double value : {bounds.min.x, bounds.min.y, bounds.max.x, bounds.max.y}) {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+}
+
+void BinaryDrawingSink::AddLine(const Line& line) {
+  Put('L', {line.a.x, line.a.y, line.b.x, line.b.y});
+  buffer_ += static_cast<char>(line.with_arrow);
+}
+
+void BinaryDrawingSink::AddCircle(const Circle& circle) {
+  Put('C', {circle.c.x, circle.c.y, circle.r});
+}
+
+void BinaryDrawingSink::AddRect(const Rect& rect) {
+  Put('R', {rect.p.x, rect.p.y, rect.len.x, rect.len.y});
+}
+
+void BinaryDrawingSink::End() {
+  buffer_ += 'E';
+  out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  buffer_.clear();
+  out_.flush();
+}
+
+void BinaryDrawingSink::Put(char tag, std::initializer_list<double> values) {
+  MaybeFlush();
+  buffer_ += tag;
+  for (double value : values) {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+}
+
+void BinaryDrawingSink::MaybeFlush() {
+  if (buffer_.size() >= kFlushSize) {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+}
+
+}  // namespace datavis
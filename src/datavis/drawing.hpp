@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+
+namespace datavis {
+
+struct Point {
+  double x, y;
+};
+
+struct Box {
+  Point min, max;
+};
+
+struct Line {
+  Point a, b;
+  bool with_arrow{true};
+};
+
+struct Circle {
+  Point c;
+  double r{2};
+};
+
+struct Rect {
+  Point p, len;
+};
+
+// Receiver of a drawing primitive by primitive, so that layout engines do not
+// have to hold the whole drawing next to the layout. Coordinates are those of
+// SvgImage. Sinks that render in order draw rects, then lines, then circles
+// like SvgImage::Write does if the primitives come in that order.
+class DrawingSink {
+ public:
+  virtual ~DrawingSink() = default;
+
+  // Called first. `bounds` is the extent of the primitives to come as
+  // SvgImage::Bounds computes it, `with_arrows` tells if any line has an arrow.
+  virtual void Begin(const Box& bounds, bool with_arrows) = 0;
+  virtual void AddLine(const Line& line) = 0;
+  virtual void AddCircle(const Circle& circle) = 0;
+  virtual void AddRect(const Rect& rect) = 0;
+  // Called last; the output is complete after it.
+  virtual void End() = 0;
+};
+
+// Primitives as records, native little-endian:
+//   header: "DVDW", uint32 version, float64 bounds[4] (min x, min y, max x, max y)
+//   'L' float64 ax, ay, bx, by, uint8 with_arrow
+//   'C' float64 cx, cy, r
+//   'R' float64 x, y, width, height
+//   'E' at the end.
+class BinaryDrawingSink : public DrawingSink {
+ public:
+  explicit BinaryDrawingSink(std::ostream& out);
+
+  void Begin(const Box& bounds, bool with_arrows) override;
+  void AddLine(const Line& line) override;
+  void AddCircle(const Circle& circle) override;
+  void AddRect(const Rect& rect) override;
+  void End() override;
+
+ private:
+  void Put(char tag, std::initializer_list<double> values);
+  void MaybeFlush();
+
+  std::ostream& out_;
+  std::string buffer_;
+};
+
+}  // namespace datavis
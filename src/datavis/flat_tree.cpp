@@ -0,0 +1,32 @@
+#include "flat_tree.hpp"
+
+#include "common.hpp"
+
+namespace datavis {
+
+FlatTree Flatten(const Graph& graph, int root) {
+  VERIFY(root >= 0 && root < graph.num_nodes);
+  FlatTree tree;
+  // Graph node and the position of its parent.
+  std::vector<std::pair<int, int>> stack{{root, -1}};
+  while (!stack.empty()) {
+    auto [v, parent] = stack.back();
+    stack.pop_back();
+    Verify(tree.id.size() < static_cast<size_t>(graph.num_nodes), "The graph is not a tree");
+    int position = tree.NumNodes();
+    tree.id.push_back(v);
+    tree.parent.push_back(parent);
+    tree.depth.push_back(parent < 0 ? 0 : tree.depth[parent] + 1);
+    auto children = graph.out[v];
+    for (size_t i = children.size(); i-- > 0;) {
+      stack.emplace_back(children[i], position);
+    }
+  }
+  tree.size.assign(tree.id.size(), 1);
+  for (int i = tree.NumNodes() - 1; i > 0; --i) {
+    tree.size[tree.parent[i]] += tree.size[i];
+  }
+  return tree;
+}
+
+}  // namespace datavis
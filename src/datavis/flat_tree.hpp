@@ -0,0 +1,45 @@
+#pragma once
+
+#include "graph.hpp"
+
+#include <vector>
+
+namespace datavis {
+
+// Tree stored in pre-order as arrays indexed by position: the subtree of the
+// node at position i is [i, i + size[i]), its first child is at i + 1 if it
+// has children and the sibling after a child c is at c + size[c]. Passes over
+// the tree are sweeps over the arrays: in order parents come before their
+// children, in reverse order children come before their parents.
+//
+// Positions are not part of it: everything that reads them, drawing edges
+// along graph.out and writing layouts, goes by graph id, so the sweeps write
+// each position once by id instead of into x and y arrays here that would
+// need another pass to be scattered by id.
+struct FlatTree {
+  std::vector<int> id;      // Graph node at each position.
+  std::vector<int> parent;  // Position of the parent, -1 for the root.
+  std::vector<int> size;
+  std::vector<int> depth;
+
+  int NumNodes() const {
+    return static_cast<int>(id.size());
+  }
+
+  // Position of the first child or -1.
+  int FirstChild(int i) const {
+    return size[i] > 1 ? i + 1 : -1;
+  }
+
+  // Position of the next sibling or -1.
+  int NextSibling(int i) const {
+    int next = i + size[i];
+    return parent[i] >= 0 && next < parent[i] + size[parent[i]] ? next : -1;
+  }
+};
+
+// Pre-order of the tree of `graph` hanging from `root`, children in the order
+// of graph.out.
+FlatTree Flatten(const Graph &graph, int root);
+
+}  // namespace datavis
@@ -0,0 +1,55 @@
+#include "graph.hpp"
+
+#include "common.hpp"
+
+#include <limits>
+
+namespace datavis {
+
+namespace {
+
+struct CsrStorage {
+  std::vector<uint32_t> out_offsets;
+  std::vector<int> out_targets;
+  std::vector<uint32_t> in_offsets;
+  std::vector<int> in_targets;
+};
+
+}  // namespace
+
+Graph Graph::FromEdges(int num_nodes, const std::vector<Edge>& edges) {
+  VERIFY(edges.size() < std::numeric_limits<uint32_t>::max());
+  auto storage = std::make_shared<CsrStorage>();
+  auto& out_offsets = storage->out_offsets;
+  auto& in_offsets = storage->in_offsets;
+  out_offsets.assign(num_nodes + 1, 0);
+  in_offsets.assign(num_nodes + 1, 0);
+  for (auto [source, target] : edges) {
+    VERIFY(source >= 0 && source < num_nodes && target >= 0 && target < num_nodes);
+    ++out_offsets[source + 1];
+    ++in_offsets[target + 1];
+  }
+  for (int v = 0; v < num_nodes; ++v) {
+    out_offsets[v + 1] += out_offsets[v];
+    in_offsets[v + 1] += in_offsets[v];
+  }
+
+  storage->out_targets.resize(edges.size());
+  storage->in_targets.resize(edges.size());
+  std::vector<uint32_t> out_pos(out_offsets.begin(), out_offsets.end() - 1);
+  std::vector<uint32_t> in_pos(in_offsets.begin(), in_offsets.end() - 1);
+  for (auto [source, target] : edges) {
+    storage->out_targets[out_pos[source]++] = target;
+    storage->in_targets[in_pos[target]++] = source;
+  }
+
+  Graph result;
+  result.num_nodes = num_nodes;
+  result.num_edges = edges.size();
+  result.out = Adjacency(out_offsets.data(), storage->out_targets.data());
+  result.in = Adjacency(in_offsets.data(), storage->in_targets.data());
+  result.storage = std::move(storage);
+  return result;
+}
+
+}  // namespace datavis
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace datavis {
+
+// Neighbour lists of all nodes in compressed sparse row form: the neighbours
+// of v are Targets()[Offsets()[v] .. Offsets()[v + 1]).
+class Adjacency {
+ public:
+  class Range {
+   public:
+    Range(const int* begin, const int* end) : begin_(begin), end_(end) {
+    }
+
+    const int* begin() const {
+      return begin_;
+    }
+
+    const int* end() const {
+      return end_;
+    }
+
+    size_t size() const {
+      return static_cast<size_t>(end_ - begin_);
+    }
+
+    bool empty() const {
+      return begin_ == end_;
+    }
+
+    int operator[](size_t i) const {
+      return begin_[i];
+    }
+
+    int back() const {
+      return end_[-1];
+    }
+
+   private:
+    const int* begin_;
+    const int* end_;
+  };
+
+  Adjacency() = default;
+
+  Adjacency(const uint32_t* offsets, const int* targets) : offsets_(offsets), targets_(targets) {
+  }
+
+  Range operator[](int v) const {
+    return {targets_ + offsets_[v], targets_ + offsets_[v + 1]};
+  }
+
+  size_t Degree(int v) const {
+    return offsets_[v + 1] - offsets_[v];
+  }
+
+  const uint32_t* Offsets() const {
+    return offsets_;
+  }
+
+  const int* Targets() const {
+    return targets_;
+  }
+
+ private:
+  const uint32_t* offsets_{nullptr};
+  const int* targets_{nullptr};
+};
+
+struct Graph {
+  struct Edge {
+    int source;
+    int target;
+  };
+
+  int num_nodes{0};
+  size_t num_edges{0};
+  // Successors and predecessors, each list in input order of the edges.
+  Adjacency out;
+  Adjacency in;
+  // Owns the arrays behind `out` and `in`: vectors or a file mapping.
+  std::shared_ptr<const void> storage;
+
+  // Builds both directions with one stable counting sort.
+  static Graph FromEdges(int num_nodes, const std::vector<Edge>& edges);
+};
+
+}  // namespace datavis
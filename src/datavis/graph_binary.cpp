@@ -0,0 +1,114 @@
+#include "graph_binary.hpp"
+
+#include "common.hpp"
+#include "graphml.hpp"
+
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+namespace datavis {
+
+namespace {
+
+constexpr char kMagic[4] = {'D', 'V', 'G', 'R'};
+constexpr uint32_t kVersion = 1;
+
+static_assert(sizeof(int) == sizeof(int32_t), "targets are mapped as int");
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_nodes;
+  uint32_t num_edges;
+};
+
+template <class T>
+void WriteArray(std::ostream &out, const T *values, size_t size) {
+  out.write(reinterpret_cast<const char *>(values), static_cast<std::streamsize>(size * sizeof(T)));
+}
+
+// Offsets must not decrease and must end at num_edges, targets must be nodes:
+// the apps index by them without checks.
+bool IsValidCsr(const uint32_t *offsets, const int *targets, size_t num_nodes, size_t num_edges) {
+  if (offsets[0] != 0 || offsets[num_nodes] != num_edges) {
+    return false;
+  }
+  for (size_t v = 0; v < num_nodes; ++v) {
+    if (offsets[v] > offsets[v + 1]) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < num_edges; ++i) {
+    if (targets[i] < 0 || static_cast<size_t>(targets[i]) >= num_nodes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Graph GraphFromBinary(std::shared_ptr<const MappedFile> file, const std::string &path, bool check) {
+  VERIFY(IsLittleEndian());
+  Verify(IsGraphBinary(*file), path + " is not a binary graph");
+  Header header;
+  std::memcpy(&header, file->Data(), sizeof(header));
+  VERIFY(header.version == kVersion);
+  VERIFY(header.num_nodes <= static_cast<uint32_t>(std::numeric_limits<int>::max()));
+  size_t num_nodes = header.num_nodes;
+  size_t num_edges = header.num_edges;
+  auto words = 2 * (num_nodes + 1) + 2 * num_edges;
+  Verify(file->Size() == sizeof(Header) + words * sizeof(uint32_t), path + " is truncated");
+
+  // The mapping is page aligned and the header keeps the arrays 4-byte aligned.
+  auto *out_offsets = reinterpret_cast<const uint32_t *>(file->Data() + sizeof(Header));
+  auto *out_targets = reinterpret_cast<const int *>(out_offsets + num_nodes + 1);
+  auto *in_offsets = reinterpret_cast<const uint32_t *>(out_targets + num_edges);
+  auto *in_targets = reinterpret_cast<const int *>(in_offsets + num_nodes + 1);
+  VERIFY(out_offsets[num_nodes] == num_edges && in_offsets[num_nodes] == num_edges);
+  Verify(!check || (IsValidCsr(out_offsets, out_targets, num_nodes, num_edges) &&
+                    IsValidCsr(in_offsets, in_targets, num_nodes, num_edges)),
+         path + " is corrupt");
+
+  Graph result;
+  result.num_nodes = static_cast<int>(num_nodes);
+  result.num_edges = num_edges;
+  result.out = Adjacency(out_offsets, out_targets);
+  result.in = Adjacency(in_offsets, in_targets);
+  result.storage = std::move(file);
+  return result;
+}
+
+}  // namespace
+
+void WriteGraphBinary(const Graph &graph, std::ostream &out) {
+  VERIFY(IsLittleEndian());
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_nodes = static_cast<uint32_t>(graph.num_nodes);
+  header.num_edges = static_cast<uint32_t>(graph.num_edges);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const auto *adjacency : {&graph.out, &graph.in}) {
+    WriteArray(out, adjacency->Offsets(), graph.num_nodes + 1);
+    WriteArray(out, adjacency->Targets(), graph.num_edges);
+  }
+  VERIFY(out.good());
+}
+
+bool IsGraphBinary(const MappedFile &file) {
+  return file.Size() >= sizeof(Header) && std::memcmp(file.Data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+Graph LoadGraphBinary(const std::string &path, bool check) {
+  return GraphFromBinary(std::make_shared<const MappedFile>(path), path, check);
+}
+
+Graph LoadGraph(const std::string &path, int num_threads, bool check) {
+  auto file = std::make_shared<const MappedFile>(path);
+  if (IsGraphBinary(*file)) {
+    return GraphFromBinary(std::move(file), path, check);
+  }
+  return ParseGraphMLFile(*file, num_threads);
+}
+
+}  // namespace datavis
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "graph.hpp"
+#include "mapped_file.hpp"
+
+#include <iosfwd>
+#include <string>
+
+namespace datavis {
+
+// Binary graph format, native little-endian:
+//   header: "DVGR", uint32 version, uint32 num_nodes, uint32 num_edges
+//   uint32 out_offsets[num_nodes + 1], int32 out_targets[num_edges]
+//   uint32 in_offsets[num_nodes + 1], int32 in_targets[num_edges]
+// i.e. the arrays of Graph::out and Graph::in.
+void WriteGraphBinary(const Graph &graph, std::ostream &out);
+
+bool IsGraphBinary(const MappedFile &file);
+
+// Zero-copy: the adjacency arrays of the result point into the mapping. Only
+// the header and the file size are checked, so a load costs the page faults
+// of the pages that are used. With `check` every offset and target is checked
+// too, in one pass over the arrays; a corrupt file fails instead of crashing
+// whoever reads the graph.
+Graph LoadGraphBinary(const std::string &path, bool check = false);
+
+// Loads a graph in the binary format or in GraphML, whichever the file is.
+Graph LoadGraph(const std::string &path, int num_threads = 0, bool check = false);
+
+}  // namespace datavis
@@ -0,0 +1,63 @@
+#include "graph_cache.hpp"
+
+#include "graph_binary.hpp"
+#include "hash.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace datavis {
+
+std::string GraphCachePath(std::string_view source) {
+  const char *dir = std::getenv("DATAVIS_GRAPH_CACHE");
+  if (!dir || !*dir) {
+    return {};
+  }
+  char name[64];
+  std::snprintf(name, sizeof(name), "/%016llx-%zu.dvgr",
+                static_cast<unsigned long long>(HashBytes(source.data(), source.size())), source.size());
+  return dir + std::string(name);
+}
+
+std::optional<Graph> LoadCachedGraph(const std::string &cache_path) {
+  if (::access(cache_path.c_str(), R_OK) != 0) {
+    return std::nullopt;
+  }
+  try {
+    return LoadGraphBinary(cache_path);
+  } catch (const std::logic_error &) {
+    // Not written by this version; it is replaced after parsing.
+    return std::nullopt;
+  }
+}
+
+void StoreCachedGraph(const Graph &graph, const std::string &cache_path) {
+  // Readers never see a partial entry: it is written aside, closed and only
+  // then renamed.
+  auto temp_path = cache_path + ".tmp" + std::to_string(::getpid());
+  std::ofstream out(temp_path, std::ios::binary);
+  if (!out.is_open()) {
+    return;
+  }
+  bool written = false;
+  try {
+    WriteGraphBinary(graph, out);
+    out.close();
+    if (!out.fail()) {
+      // Entries are checked in full once, here; loads check only their size.
+      LoadGraphBinary(temp_path, true);
+      written = true;
+    }
+  } catch (const std::logic_error &) {
+    // The stream failed while writing, e.g. the disk is full.
+  }
+  if (!written || std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+  }
+}
+
+}  // namespace datavis
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "graph.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace datavis {
+
+// Opt-in cache of parsed graphs. If the DATAVIS_GRAPH_CACHE environment
+// variable names a directory, graphs parsed from GraphML files are stored
+// there in the binary format, keyed by a hash of the source bytes, and later
+// loads of the same content map the stored copy instead of parsing.
+
+// Path of the cache entry for a source document, empty if caching is off.
+std::string GraphCachePath(std::string_view source);
+
+// Nothing if there is no usable entry.
+std::optional<Graph> LoadCachedGraph(const std::string &cache_path);
+
+// Failures to write the entry are ignored and leave no file behind, the cache
+// is only an optimization.
+void StoreCachedGraph(const Graph &graph, const std::string &cache_path);
+
+}  // namespace datavis
@@ -1,35 +1,279 @@
 #include "graphml.hpp"
 
 #include "common.hpp"
+#include "graph_cache.hpp"
+#include "interner.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "xml.hpp"
 
-#include "pugixml.hpp"
-
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <unordered_map>
+#include <vector>
 
 namespace datavis {
 
 using namespace std::literals;
 
-Graph ParseGraphML(std::istream &in) {
-  pugi::xml_document doc;
-  VERIFY(doc.load(in));
-  auto root = doc.child("graphml");
-  VERIFY(!root.empty());
-  auto graph = root.child("graph");
-  VERIFY(graph.attribute("edgedefault").value() == "directed"sv);
-  Graph result{0};
-  std::unordered_map<std::string, int> name_to_id;
-  for (const auto &record : graph.children()) {
-    if (record.name() == "node"sv) {
-      name_to_id[record.attribute("id").value()] = result.num_nodes++;
-    } else if (record.name() == "edge"sv) {
-      int source = name_to_id.at(record.attribute("source").value());
-      int target = name_to_id.at(record.attribute("target").value());
-      result.edges.push_back({source, target});
+namespace {
+
+// Generated GraphML names nodes "<prefix><number>" with dense numbers, so
+// while all names follow the pattern of the first one, ids are found by
+// parsing the number. The first name that does not fit moves the table to the
+// interner. Names from an in-memory document are referenced in place, the
+// rest are copied by the interner.
+class NodeIds {
+ public:
+  explicit NodeIds(const XmlReader& reader) : reader_(reader) {
+  }
+
+  void Add(std::string_view name, int id) {
+    if (dense_ && by_number_.empty()) {
+      prefix_ = name.substr(0, name.find_last_not_of("0123456789") + 1);
+    }
+    if (dense_) {
+      auto number = ParseNumber(name);
+      if (number != kNoNumber && number <= 2 * by_number_.size() + kSlack) {
+        if (number >= by_number_.size()) {
+          by_number_.resize(number + 1, -1);
+        }
+        by_number_[number] = id;
+        return;
+      }
+      FallBackToInterner();
+    }
+    ids_.Insert(name, id, reader_.IsPersistent(name));
+  }
+
+  int Find(std::string_view name) const {
+    int id = -1;
+    if (dense_) {
+      auto number = ParseNumber(name);
+      if (number < by_number_.size()) {
+        id = by_number_[number];
+      }
+    } else {
+      id = ids_.Find(name);
+    }
+    Verify(id >= 0, "Unknown node id: " + std::string(name));
+    return id;
+  }
+
+ private:
+  static constexpr size_t kNoNumber = std::numeric_limits<size_t>::max();
+  static constexpr size_t kSlack = 1024;
+
+  // Number in `name` if it is the prefix followed by a decimal without
+  // leading zeros, so that distinct names never map to the same number.
+  size_t ParseNumber(std::string_view name) const {
+    if (name.size() <= prefix_.size() || name.compare(0, prefix_.size(), prefix_) != 0) {
+      return kNoNumber;
+    }
+    auto digits = name.substr(prefix_.size());
+    if (digits[0] == '0' && digits.size() > 1) {
+      return kNoNumber;
+    }
+    size_t number;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+    if (error != std::errc() || end != digits.data() + digits.size()) {
+      return kNoNumber;
+    }
+    return number;
+  }
+
+  void FallBackToInterner() {
+    dense_ = false;
+    for (size_t number = 0; number < by_number_.size(); ++number) {
+      if (by_number_[number] >= 0) {
+        ids_.Insert(std::string(prefix_) + std::to_string(number), by_number_[number]);
+      }
+    }
+    by_number_ = {};
+  }
+
+  const XmlReader& reader_;
+  bool dense_{true};
+  std::string prefix_;
+  std::vector<int> by_number_;
+  StringInterner ids_;
+};
+
+// Skips the content of an element whose opening tag has just been read.
+void SkipElement(XmlReader& reader, XmlTag& tag) {
+  if (tag.kind != XmlTag::Kind::kOpen) {
+    return;
+  }
+  for (int depth = 1; depth > 0;) {
+    VERIFY(reader.Next(tag));
+    if (tag.kind == XmlTag::Kind::kOpen) {
+      ++depth;
+    } else if (tag.kind == XmlTag::Kind::kClose) {
+      --depth;
+    }
+  }
+}
+
+struct EdgeChunk {
+  std::vector<Graph::Edge> edges;
+  bool closed{false};
+  bool failed{false};
+};
+
+// Reads <edge> records from a part of the graph element. A chunk that meets
+// anything else, or is cut in the middle of markup, is marked as failed.
+void ReadEdgeChunk(std::string_view text, const NodeIds& name_to_id, EdgeChunk& chunk) {
+  XmlReader reader(text.data(), text.data() + text.size());
+  XmlTag tag;
+  try {
+    while (reader.Next(tag)) {
+      if (tag.kind == XmlTag::Kind::kClose) {
+        chunk.closed = tag.name == "graph"sv;
+        chunk.failed = !chunk.closed;
+        return;
+      }
+      if (tag.name != "edge"sv) {
+        chunk.failed = true;
+        return;
+      }
+      int source = name_to_id.Find(tag.Attribute("source"));
+      int target = name_to_id.Find(tag.Attribute("target"));
+      chunk.edges.push_back({source, target});
+      SkipElement(reader, tag);
+    }
+  } catch (const std::logic_error&) {
+    chunk.failed = true;
+  }
+}
+
+// Splits the rest of an in-memory document at <edge> tags and reads the
+// chunks on worker threads against the complete node table. Returns false,
+// leaving `edges` untouched, if the edge records can not be read this way
+// (e.g. a <node> after them); the caller then goes on sequentially and
+// reports errors, if any.
+bool ReadEdgesInParallel(const XmlReader& reader, const NodeIds& name_to_id, int num_threads,
+                         std::vector<Graph::Edge>& edges) {
+  constexpr size_t kMinChunkSize = 1 << 20;
+  auto text = reader.Remaining();
+  num_threads = NumThreads(num_threads);
+  auto num_chunks = std::min(text.size() / kMinChunkSize, static_cast<size_t>(num_threads) * 4);
+  if (num_threads == 1 || num_chunks < 2) {
+    return false;
+  }
+
+  auto is_edge_tag = [&](size_t pos) {
+    constexpr auto kNameEnd = " \t\r\n/>"sv;
+    return pos + 5 < text.size() && kNameEnd.find(text[pos + 5]) != std::string_view::npos;
+  };
+  std::vector<size_t> bounds{0};
+  for (size_t i = 1; i < num_chunks; ++i) {
+    auto pos = std::max(bounds.back(), text.size() / num_chunks * i);
+    while ((pos = text.find("<edge"sv, pos)) != std::string_view::npos && !is_edge_tag(pos)) {
+      pos += 5;
+    }
+    bounds.push_back(std::min(pos, text.size()));
+  }
+  bounds.push_back(text.size());
+
+  std::vector<EdgeChunk> chunks(num_chunks);
+  ParallelFor(num_chunks, num_threads, [&](size_t i) {
+    ReadEdgeChunk(text.substr(bounds[i], bounds[i + 1] - bounds[i]), name_to_id, chunks[i]);
+  });
+
+  size_t num_edges = 0;
+  size_t num_used = 0;
+  while (num_used < num_chunks && !chunks[num_used].failed) {
+    num_edges += chunks[num_used].edges.size();
+    if (chunks[num_used++].closed) {
+      break;
+    }
+  }
+  if (num_used == 0 || !chunks[num_used - 1].closed) {
+    return false;
+  }
+  edges.reserve(edges.size() + num_edges);
+  for (size_t i = 0; i < num_used; ++i) {
+    edges.insert(edges.end(), chunks[i].edges.begin(), chunks[i].edges.end());
+  }
+  return true;
+}
+
+Graph ParseGraphML(XmlReader& reader, int num_threads) {
+  XmlTag tag;
+  VERIFY(reader.Next(tag));
+  VERIFY(tag.name == "graphml"sv && tag.kind == XmlTag::Kind::kOpen);
+  while (true) {
+    VERIFY(reader.Next(tag));
+    VERIFY(tag.kind != XmlTag::Kind::kClose);
+    if (tag.name == "graph"sv) {
+      break;
+    }
+    SkipElement(reader, tag);
+  }
+  VERIFY(tag.Attribute("edgedefault") == "directed"sv);
+
+  int num_nodes = 0;
+  std::vector<Graph::Edge> edges;
+  if (tag.kind == XmlTag::Kind::kEmpty) {
+    return Graph::FromEdges(num_nodes, edges);
+  }
+  NodeIds name_to_id(reader);
+  bool tried_parallel = num_threads == 1;
+  while (true) {
+    VERIFY(reader.Next(tag));
+    if (tag.kind == XmlTag::Kind::kClose) {
+      VERIFY(tag.name == "graph"sv);
+      break;
+    }
+    if (tag.name == "node"sv) {
+      name_to_id.Add(tag.Attribute("id"), num_nodes++);
+    } else if (tag.name == "edge"sv) {
+      int source = name_to_id.Find(tag.Attribute("source"));
+      int target = name_to_id.Find(tag.Attribute("target"));
+      edges.push_back({source, target});
+      if (!tried_parallel) {
+        // All nodes before the first edge are known, and the table is only
+        // read from now on.
+        tried_parallel = true;
+        SkipElement(reader, tag);
+        if (ReadEdgesInParallel(reader, name_to_id, num_threads, edges)) {
+          break;
+        }
+        continue;
+      }
     } else {
       VERIFY(false);
     }
+    SkipElement(reader, tag);
+  }
+  return Graph::FromEdges(num_nodes, edges);
+}
+
+}  // namespace
+
+Graph ParseGraphML(std::istream &in) {
+  XmlReader reader(in);
+  return ParseGraphML(reader, 1);
+}
+
+Graph ParseGraphMLFile(const std::string &path, int num_threads) {
+  return ParseGraphMLFile(MappedFile(path), num_threads);
+}
+
+Graph ParseGraphMLFile(const MappedFile &file, int num_threads) {
+  auto cache_path = GraphCachePath(std::string_view(file.Data(), file.Size()));
+  if (!cache_path.empty()) {
+    if (auto cached = LoadCachedGraph(cache_path)) {
+      return std::move(*cached);
+    }
+  }
+  XmlReader reader(file.Data(), file.Data() + file.Size());
+  auto result = ParseGraphML(reader, num_threads);
+  if (!cache_path.empty()) {
+    StoreCachedGraph(result, cache_path);
   }
   return result;
 }
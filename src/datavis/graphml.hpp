@@ -1,20 +1,22 @@
 #pragma once
 
+#include "graph.hpp"
+#include "mapped_file.hpp"
+
 #include <iosfwd>
-#include <vector>
+#include <string>
 
 namespace datavis {
 
-struct Graph {
-  struct Edge {
-    int source;
-    int target;
-  };
+Graph ParseGraphML(std::istream &in);
 
-  int num_nodes;
-  std::vector<Edge> edges;
-};
+// Maps the file and parses it in place, without copying it into a stream.
+// Large edge lists are read by `num_threads` threads (0 means all cores);
+// the result does not depend on the number of threads. Results are cached if
+// DATAVIS_GRAPH_CACHE is set, see graph_cache.hpp.
+Graph ParseGraphMLFile(const std::string &path, int num_threads = 0);
 
-Graph ParseGraphML(std::istream &in);
+// Same for a file that is already mapped.
+Graph ParseGraphMLFile(const MappedFile &file, int num_threads = 0);
 
 }  // namespace datavis
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace datavis {
+
+// Fast non-cryptographic 64-bit hash, reading the input eight bytes at a time.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0) {
+  constexpr uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+  auto mix = [](uint64_t h) {
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+  };
+  auto* p = static_cast<const unsigned char*>(data);
+  uint64_t h = seed ^ (size * kMul);
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    h = (h ^ mix(word * kMul)) * kMul;
+  }
+  if (size > 0) {
+    uint64_t word = 0;
+    std::memcpy(&word, p, size);
+    h = (h ^ mix(word * kMul)) * kMul;
+  }
+  return mix(h);
+}
+
+}  // namespace datavis
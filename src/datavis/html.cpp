@@ -0,0 +1,183 @@
+#include "html.hpp"
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+namespace datavis {
+
+namespace {
+
+constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Written in pieces so that the encoded buffers are never held whole.
+void WriteBase64(const void* data, size_t size, std::ostream& out) {
+  constexpr size_t kBlock = 3 << 16;
+  auto* bytes = static_cast<const uint8_t*>(data);
+  std::string text;
+  for (size_t begin = 0; begin < size; begin += kBlock) {
+    auto end = std::min(size, begin + kBlock);
+    text.clear();
+    for (auto i = begin; i < end; i += 3) {
+      uint32_t word = uint32_t{bytes[i]} << 16;
+      if (i + 1 < end) {
+        word |= uint32_t{bytes[i + 1]} << 8;
+      }
+      if (i + 2 < end) {
+        word |= bytes[i + 2];
+      }
+      text += kBase64[word >> 18];
+      text += kBase64[(word >> 12) & 63];
+      text += i + 1 < end ? kBase64[(word >> 6) & 63] : '=';
+      text += i + 2 < end ? kBase64[word & 63] : '=';
+    }
+    out << text;
+  }
+}
+
+template <class T>
+void WriteArray(const char* name, const char* type, const std::vector<T>& values, std::ostream& out) {
+  out << "const " << name << " = new " << type << "(decode(\"";
+  WriteBase64(values.data(), values.size() * sizeof(T), out);
+  out << "\"));\n";
+}
+
+// Everything after the buffers. Typed arrays are little-endian on all
+// browsers in use, and the writer checks that it is too.
+constexpr char kScript[] = R"(const canvas = document.getElementById("view");
+const ctx = canvas.getContext("2d");
+let zoom = Math.min(innerWidth / width, innerHeight / height);
+let shift = [0, 0];
+
+function draw() {
+  canvas.width = innerWidth;
+  canvas.height = innerHeight;
+  ctx.setTransform(1, 0, 0, 1, 0, 0);
+  ctx.fillStyle = "white";
+  ctx.fillRect(0, 0, canvas.width, canvas.height);
+  ctx.setTransform(zoom, 0, 0, zoom, shift[0], shift[1]);
+
+  ctx.lineWidth = 1;
+  ctx.strokeStyle = "black";
+  ctx.fillStyle = "white";
+  for (let i = 0; i < rects.length; i += 4) {
+    ctx.fillRect(rects[i], rects[i + 1], rects[i + 2], rects[i + 3]);
+    ctx.strokeRect(rects[i], rects[i + 1], rects[i + 2], rects[i + 3]);
+  }
+
+  ctx.lineWidth = 0.1;
+  ctx.beginPath();
+  for (let i = 0; i < lines.length; i += 4) {
+    ctx.moveTo(lines[i], lines[i + 1]);
+    ctx.lineTo(lines[i + 2], lines[i + 3]);
+  }
+  ctx.stroke();
+  ctx.fillStyle = "black";
+  ctx.beginPath();
+  for (let i = 0, j = 0; i < lines.length; i += 4, ++j) {
+    let dx = lines[i + 2] - lines[i], dy = lines[i + 3] - lines[i + 1];
+    const length = Math.hypot(dx, dy);
+    if (!arrows[j] || length == 0) {
+      continue;
+    }
+    dx /= length;
+    dy /= length;
+    const x = lines[i + 2], y = lines[i + 3];
+    ctx.moveTo(x - 2 * dx, y - 2 * dy);
+    ctx.lineTo(x - 4 * dx - dy, y - 4 * dy + dx);
+    ctx.lineTo(x - 4 * dx + dy, y - 4 * dy - dx);
+    ctx.closePath();
+  }
+  ctx.fill();
+
+  ctx.lineWidth = 0.2;
+  ctx.fillStyle = "red";
+  ctx.beginPath();
+  for (let i = 0; i < circles.length; i += 3) {
+    ctx.moveTo(circles[i] + circles[i + 2], circles[i + 1]);
+    ctx.arc(circles[i], circles[i + 1], circles[i + 2], 0, 2 * Math.PI);
+  }
+  ctx.fill();
+  ctx.stroke();
+}
+
+canvas.addEventListener("wheel", event => {
+  event.preventDefault();
+  const factor = Math.exp(-event.deltaY / 500);
+  shift = [event.offsetX - (event.offsetX - shift[0]) * factor, event.offsetY - (event.offsetY - shift[1]) * factor];
+  zoom *= factor;
+  draw();
+}, {passive: false});
+let drag = null;
+canvas.addEventListener("mousedown", event => drag = [event.clientX - shift[0], event.clientY - shift[1]]);
+addEventListener("mouseup", () => drag = null);
+addEventListener("mousemove", event => {
+  if (drag) {
+    shift = [event.clientX - drag[0], event.clientY - drag[1]];
+    draw();
+  }
+});
+addEventListener("resize", draw);
+draw();
+</script>
+</body>
+</html>
+)";
+
+}  // namespace
+
+HtmlSink::HtmlSink(std::ostream& out, const SvgImage& settings) : out_(out), settings_(settings.WithoutPrimitives()) {
+  // The buffers are the bytes of float arrays as they are in memory.
+  VERIFY(IsLittleEndian());
+}
+
+void HtmlSink::Begin(const Box& bounds, bool) {
+  size_ = settings_.Size(bounds);
+}
+
+void HtmlSink::AddLine(const Line& line) {
+  Put(lines_, line.a);
+  Put(lines_, line.b);
+  arrows_.push_back(line.with_arrow);
+}
+
+void HtmlSink::AddCircle(const Circle& circle) {
+  Put(circles_, circle.c);
+  circles_.push_back(static_cast<float>(circle.r));
+}
+
+void HtmlSink::AddRect(const Rect& rect) {
+  for (double value : {rect.p.x, rect.p.y, rect.len.x, rect.len.y}) {
+    rects_.push_back(static_cast<float>(value));
+  }
+}
+
+void HtmlSink::End() {
+  out_ << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>datavis</title>\n"
+          "<style>body{margin:0;overflow:hidden}canvas{display:block}</style>\n</head>\n<body>\n"
+          "<canvas id=\"view\"></canvas>\n<script>\n";
+  out_ << "const width = " << size_.x << ", height = " << size_.y << ";\n";
+  out_ << "function decode(text) {\n"
+          "  const bytes = atob(text);\n"
+          "  const result = new Uint8Array(bytes.length);\n"
+          "  for (let i = 0; i < bytes.length; ++i) {\n"
+          "    result[i] = bytes.charCodeAt(i);\n"
+          "  }\n"
+          "  return result.buffer;\n"
+          "}\n";
+  WriteArray("lines", "Float32Array", lines_, out_);
+  WriteArray("arrows", "Uint8Array", arrows_, out_);
+  WriteArray("circles", "Float32Array", circles_, out_);
+  WriteArray("rects", "Float32Array", rects_, out_);
+  out_ << kScript;
+  out_.flush();
+}
+
+void HtmlSink::Put(std::vector<float>& values, Point p) const {
+  values.push_back(static_cast<float>(settings_.padding + p.x * settings_.scale.x));
+  values.push_back(static_cast<float>(settings_.padding + p.y * settings_.scale.y));
+}
+
+}  // namespace datavis
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "drawing.hpp"
+#include "svg.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace datavis {
+
+// Single-file HTML viewer: the primitives, in SVG units, are embedded as
+// base64 Float32Array buffers and drawn by a small canvas script with pan
+// (drag) and zoom (wheel), so the browser holds a few typed arrays instead of
+// a DOM node per primitive. Looks like SvgImage::Write.
+class HtmlSink : public DrawingSink {
+ public:
+  HtmlSink(std::ostream& out, const SvgImage& settings);
+
+  void Begin(const Box& bounds, bool with_arrows) override;
+  void AddLine(const Line& line) override;
+  void AddCircle(const Circle& circle) override;
+  void AddRect(const Rect& rect) override;
+  void End() override;
+
+ private:
+  void Put(std::vector<float>& values, Point p) const;
+
+  std::ostream& out_;
+  SvgImage settings_;
+  Point size_{0, 0};
+  // ax, ay, bx, by per line; cx, cy, r per circle; x, y, width, height per rect.
+  std::vector<float> lines_;
+  std::vector<uint8_t> arrows_;
+  std::vector<float> circles_;
+  std::vector<float> rects_;
+};
+
+}  // namespace datavis
@@ -0,0 +1,87 @@
+#include "interner.hpp"
+
+#include "common.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace datavis {
+
+namespace {
+
+constexpr size_t kInitialSlots = 1 << 10;
+constexpr size_t kArenaBlockSize = 1 << 16;
+
+}  // namespace
+
+StringInterner::StringInterner() : slots_(kInitialSlots) {
+}
+
+void StringInterner::Insert(std::string_view key, int id, bool persistent) {
+  VERIFY(id >= 0 && key.size() <= std::numeric_limits<uint32_t>::max());
+  if (2 * (size_ + 1) > slots_.size()) {
+    Grow();
+  }
+  auto hash = HashBytes(key.data(), key.size());
+  auto mask = slots_.size() - 1;
+  for (auto i = hash & mask;; i = (i + 1) & mask) {
+    auto& slot = slots_[i];
+    if (slot.id < 0) {
+      slot = {hash, persistent ? key.data() : Store(key), static_cast<uint32_t>(key.size()), id};
+      ++size_;
+      return;
+    }
+    if (slot.hash == hash && std::string_view(slot.data, slot.size) == key) {
+      slot.id = id;
+      return;
+    }
+  }
+}
+
+int StringInterner::Find(std::string_view key) const {
+  auto hash = HashBytes(key.data(), key.size());
+  auto mask = slots_.size() - 1;
+  for (auto i = hash & mask;; i = (i + 1) & mask) {
+    const auto& slot = slots_[i];
+    if (slot.id < 0) {
+      return -1;
+    }
+    if (slot.hash == hash && std::string_view(slot.data, slot.size) == key) {
+      return slot.id;
+    }
+  }
+}
+
+const char* StringInterner::Store(std::string_view key) {
+  if (key.size() > arena_left_) {
+    auto block_size = std::max(kArenaBlockSize, key.size());
+    arena_.emplace_back(new char[block_size]);
+    arena_pos_ = arena_.back().get();
+    arena_left_ = block_size;
+  }
+  auto* data = arena_pos_;
+  std::memcpy(data, key.data(), key.size());
+  arena_pos_ += key.size();
+  arena_left_ -= key.size();
+  return data;
+}
+
+void StringInterner::Grow() {
+  std::vector<Slot> slots(slots_.size() * 2);
+  auto mask = slots.size() - 1;
+  for (const auto& slot : slots_) {
+    if (slot.id < 0) {
+      continue;
+    }
+    auto i = slot.hash & mask;
+    while (slots[i].id >= 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+  slots_.swap(slots);
+}
+
+}  // namespace datavis
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace datavis {
+
+// String to id table for hot lookup paths. Open addressing with linear
+// probing; slots keep the full hash, so keys are hashed once and compared only
+// on a hash match. Lookups never allocate.
+class StringInterner {
+ public:
+  StringInterner();
+
+  // Maps `key` to `id`, replacing a previous mapping. Unless `persistent` is
+  // set (the key outlives the interner), the key bytes are copied to an arena.
+  void Insert(std::string_view key, int id, bool persistent = false);
+
+  // Returns -1 for unknown keys.
+  int Find(std::string_view key) const;
+
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  struct Slot {
+    uint64_t hash;
+    const char* data;
+    uint32_t size;
+    int id{-1};
+  };
+
+  const char* Store(std::string_view key);
+  void Grow();
+
+  std::vector<Slot> slots_;
+  size_t size_{0};
+  std::vector<std::unique_ptr<char[]>> arena_;
+  size_t arena_left_{0};
+  char* arena_pos_{nullptr};
+};
+
+}  // namespace datavis
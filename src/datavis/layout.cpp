@@ -0,0 +1,101 @@
+#include "layout.hpp"
+
+#include "common.hpp"
+
+#include <charconv>
+#include <limits>
+
+namespace datavis {
+
+namespace {
+
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFlushSize = 1 << 20;
+
+}  // namespace
+
+LayoutWriter::LayoutWriter(const std::string& path, Format format, size_t num_nodes, size_t num_edges)
+    : out_(path, format == Format::kBinary ? std::ios::binary : std::ios::out),
+      format_(format),
+      num_nodes_(num_nodes),
+      num_edges_(num_edges) {
+  Verify(out_.is_open(), "Can not open " + path);
+  if (format_ == Format::kBinary) {
+    VERIFY(IsLittleEndian());
+    VERIFY(num_nodes <= std::numeric_limits<uint32_t>::max() && num_edges <= std::numeric_limits<uint32_t>::max());
+    buffer_ += "DVLY";
+    Put(kVersion);
+    Put(static_cast<uint32_t>(num_nodes));
+    Put(static_cast<uint32_t>(num_edges));
+  }
+}
+
+void LayoutWriter::AddNode(int id, Point p) {
+  VERIFY(edges_written_ == 0);
+  ++nodes_written_;
+  if (format_ == Format::kBinary) {
+    Put(static_cast<int32_t>(id));
+    Put(p.x);
+    Put(p.y);
+  } else {
+    buffer_ += "node,";
+    buffer_ += std::to_string(id);
+    PutNumber(p.x);
+    PutNumber(p.y);
+    buffer_ += '\n';
+  }
+  MaybeFlush();
+}
+
+void LayoutWriter::AddEdge(int from, int to, const std::vector<Point>& bends) {
+  ++edges_written_;
+  if (format_ == Format::kBinary) {
+    Put(static_cast<int32_t>(from));
+    Put(static_cast<int32_t>(to));
+    Put(static_cast<uint32_t>(bends.size()));
+    for (auto p : bends) {
+      Put(p.x);
+      Put(p.y);
+    }
+  } else {
+    buffer_ += "edge,";
+    buffer_ += std::to_string(from);
+    buffer_ += ',';
+    buffer_ += std::to_string(to);
+    for (auto p : bends) {
+      PutNumber(p.x);
+      PutNumber(p.y);
+    }
+    buffer_ += '\n';
+  }
+  MaybeFlush();
+}
+
+void LayoutWriter::End() {
+  VERIFY(nodes_written_ == num_nodes_ && edges_written_ == num_edges_);
+  out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  buffer_.clear();
+  out_.flush();
+  Verify(out_.good(), "Can not write the layout");
+}
+
+template <class T>
+void LayoutWriter::Put(T value) {
+  buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void LayoutWriter::PutNumber(double value) {
+  char text[32];
+  text[0] = ',';
+  auto result = std::to_chars(text + 1, text + sizeof(text), value);
+  buffer_.append(text, result.ptr);
+}
+
+void LayoutWriter::MaybeFlush() {
+  if (buffer_.size() >= kFlushSize) {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+}
+
+}  // namespace datavis
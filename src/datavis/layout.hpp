@@ -0,0 +1,50 @@
+#pragma once
+
+#include "drawing.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace datavis {
+
+// Node positions and edge polylines of a layout, for tools that need the
+// coordinates rather than a drawing. Coordinates are those of the layout,
+// before SvgImage scaling. Two formats:
+//   binary, native little-endian:
+//     header: "DVLY", uint32 version, uint32 num_nodes, uint32 num_edges
+//     num_nodes times: int32 id, float64 x, float64 y
+//     num_edges times: int32 from, int32 to, uint32 num_bends, float64 bends[2 * num_bends]
+//   csv, numbers in the shortest form that reads back exactly:
+//     node,<id>,<x>,<y>
+//     edge,<from>,<to>[,<x>,<y>]...  with a pair per bend point
+// Nodes come before edges.
+class LayoutWriter {
+ public:
+  enum class Format { kBinary, kCsv };
+
+  LayoutWriter(const std::string &path, Format format, size_t num_nodes, size_t num_edges);
+
+  void AddNode(int id, Point p);
+  // Bend points of the edge between the ends, e.g. dummy nodes of a long edge.
+  void AddEdge(int from, int to, const std::vector<Point> &bends = {});
+  // Checks that the counts given at construction were written.
+  void End();
+
+ private:
+  template <class T>
+  void Put(T value);
+  void PutNumber(double value);
+  void MaybeFlush();
+
+  std::ofstream out_;
+  Format format_;
+  size_t num_nodes_;
+  size_t num_edges_;
+  size_t nodes_written_{0};
+  size_t edges_written_{0};
+  std::string buffer_;
+};
+
+}  // namespace datavis
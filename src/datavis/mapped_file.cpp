@@ -0,0 +1,38 @@
+#include "mapped_file.hpp"
+
+#include "common.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace datavis {
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  Verify(fd >= 0, "Cannot open " + path);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    Verify(false, "Cannot stat " + path);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ != 0) {
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    Verify(data != MAP_FAILED, "Cannot map " + path);
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+  } else {
+    ::close(fd);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+}  // namespace datavis
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace datavis {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* Data() const {
+    return data_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+};
+
+}  // namespace datavis
@@ -0,0 +1,62 @@
+#include "options.hpp"
+
+#include "common.hpp"
+
+#include <charconv>
+
+namespace datavis {
+
+Options::Options(int& argc, char** argv) {
+  int num_positional = 0;
+  for (int i = 0; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (i == 0 || arg.substr(0, 2) != "--") {
+      argv[num_positional++] = argv[i];
+      continue;
+    }
+    arg.remove_prefix(2);
+    auto eq = arg.find('=');
+    if (eq == std::string_view::npos) {
+      values_[std::string(arg)];
+    } else {
+      values_[std::string(arg.substr(0, eq))] = std::string(arg.substr(eq + 1));
+    }
+  }
+  argc = num_positional;
+  argv[argc] = nullptr;
+}
+
+bool Options::Has(std::string_view name) const {
+  return values_.find(name) != values_.end();
+}
+
+std::string Options::Get(std::string_view name, const std::string& fallback) const {
+  auto it = values_.find(name);
+  return it == values_.end() ? fallback : it->second;
+}
+
+int Options::GetInt(std::string_view name, int fallback) const {
+  auto it = values_.find(name);
+  if (it == values_.end()) {
+    return fallback;
+  }
+  const auto& text = it->second;
+  int value;
+  auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  Verify(error == std::errc() && end == text.data() + text.size(), "Bad value of --" + it->first);
+  return value;
+}
+
+double Options::GetDouble(std::string_view name, double fallback) const {
+  auto it = values_.find(name);
+  if (it == values_.end()) {
+    return fallback;
+  }
+  const auto& text = it->second;
+  double value;
+  auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  Verify(error == std::errc() && end == text.data() + text.size(), "Bad value of --" + it->first);
+  return value;
+}
+
+}  // namespace datavis
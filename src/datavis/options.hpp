@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace datavis {
+
+// Command line options of the apps: "--name" or "--name=value" arguments
+// anywhere on the command line. They are removed from argv, so the apps keep
+// checking their positional arguments by argc.
+class Options {
+ public:
+  Options(int& argc, char** argv);
+
+  bool Has(std::string_view name) const;
+
+  // `fallback` if the option is absent.
+  std::string Get(std::string_view name, const std::string& fallback = {}) const;
+  int GetInt(std::string_view name, int fallback) const;
+  double GetDouble(std::string_view name, double fallback) const;
+
+ private:
+  std::map<std::string, std::string, std::less<>> values_;
+};
+
+}  // namespace datavis
@@ -0,0 +1,145 @@
+#include "output.hpp"
+
+#include "common.hpp"
+#include "html.hpp"
+#include "raster.hpp"
+#include "tiles.hpp"
+
+#include <fstream>
+
+namespace datavis {
+
+namespace {
+
+bool EndsWith(const std::string& text, const std::string& suffix) {
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+enum class DrawingFormat { kSvg, kPpm, kPng, kHtml, kBinary, kTiles };
+
+// The one place that maps a drawing path to its format.
+DrawingFormat FormatOf(const std::string& path, const Options& options) {
+  if (options.Has("tiles")) {
+    return DrawingFormat::kTiles;
+  }
+  if (EndsWith(path, ".ppm")) {
+    return DrawingFormat::kPpm;
+  }
+  if (EndsWith(path, ".png")) {
+    return DrawingFormat::kPng;
+  }
+  if (EndsWith(path, ".html")) {
+    return DrawingFormat::kHtml;
+  }
+  if (EndsWith(path, ".dvd")) {
+    return DrawingFormat::kBinary;
+  }
+  return DrawingFormat::kSvg;
+}
+
+// Owns the file that the wrapped sink writes to.
+class FileSink : public DrawingSink {
+ public:
+  FileSink(const std::string& path, std::ios::openmode mode) : out_(path, mode) {
+    Verify(out_.is_open(), "Can not open " + path);
+  }
+
+  std::ostream& Stream() {
+    return out_;
+  }
+
+  void Wrap(std::unique_ptr<DrawingSink> sink) {
+    sink_ = std::move(sink);
+  }
+
+  void Begin(const Box& bounds, bool with_arrows) override {
+    sink_->Begin(bounds, with_arrows);
+  }
+
+  void AddLine(const Line& line) override {
+    sink_->AddLine(line);
+  }
+
+  void AddCircle(const Circle& circle) override {
+    sink_->AddCircle(circle);
+  }
+
+  void AddRect(const Rect& rect) override {
+    sink_->AddRect(rect);
+  }
+
+  void End() override {
+    sink_->End();
+    out_.flush();
+    Verify(out_.good(), "Can not write the drawing");
+  }
+
+ private:
+  std::ofstream out_;
+  std::unique_ptr<DrawingSink> sink_;
+};
+
+}  // namespace
+
+std::unique_ptr<DrawingSink> OpenDrawing(const std::string& path, const SvgImage& settings, const Options& options) {
+  auto pixels_per_unit = options.GetDouble("raster-scale", 1);
+  auto format = FormatOf(path, options);
+  if (format == DrawingFormat::kTiles) {
+    TileOptions tiles;
+    auto tile_format = options.Get("tiles");
+    if (tile_format == "ppm") {
+      tiles.format = TileOptions::Format::kPpm;
+    } else if (tile_format == "svg") {
+      tiles.format = TileOptions::Format::kSvg;
+    } else {
+      Verify(tile_format.empty() || tile_format == "png", "Bad value of --tiles");
+    }
+    tiles.tile_size = options.GetInt("tile-size", tiles.tile_size);
+    tiles.pixels_per_unit = pixels_per_unit;
+    return std::make_unique<TileSink>(path, settings, tiles);
+  }
+  bool binary = format == DrawingFormat::kPpm || format == DrawingFormat::kPng || format == DrawingFormat::kBinary;
+  auto result = std::make_unique<FileSink>(path, binary ? std::ios::binary : std::ios::out);
+  if (format == DrawingFormat::kPpm || format == DrawingFormat::kPng) {
+    auto raster_format = format == DrawingFormat::kPpm ? RasterFormat::kPpm : RasterFormat::kPng;
+    result->Wrap(std::make_unique<RasterSink>(result->Stream(), raster_format, settings, pixels_per_unit));
+  } else if (format == DrawingFormat::kHtml) {
+    result->Wrap(std::make_unique<HtmlSink>(result->Stream(), settings));
+  } else if (format == DrawingFormat::kBinary) {
+    result->Wrap(std::make_unique<BinaryDrawingSink>(result->Stream()));
+  } else {
+    result->Wrap(std::make_unique<SvgStream>(result->Stream(), settings));
+  }
+  return result;
+}
+
+bool IsSvgPath(const std::string& path, const Options& options) {
+  return FormatOf(path, options) == DrawingFormat::kSvg;
+}
+
+bool IsLayoutPath(const std::string& path) {
+  return EndsWith(path, ".dvl") || EndsWith(path, ".csv");
+}
+
+std::unique_ptr<LayoutWriter> OpenLayout(const std::string& path, size_t num_nodes, size_t num_edges) {
+  if (EndsWith(path, ".dvl")) {
+    return std::make_unique<LayoutWriter>(path, LayoutWriter::Format::kBinary, num_nodes, num_edges);
+  }
+  if (EndsWith(path, ".csv")) {
+    return std::make_unique<LayoutWriter>(path, LayoutWriter::Format::kCsv, num_nodes, num_edges);
+  }
+  return nullptr;
+}
+
+void SaveImage(const SvgImage& image, const std::string& path, const Options& options) {
+  if (IsSvgPath(path, options)) {
+    // Keeps the symbols, which DrawTo expands.
+    std::ofstream out(path);
+    Verify(out.is_open(), "Can not open " + path);
+    image.Write(out);
+    return;
+  }
+  image.DrawTo(*OpenDrawing(path, image, options));
+}
+
+}  // namespace datavis
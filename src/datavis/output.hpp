@@ -0,0 +1,35 @@
+#pragma once
+
+#include "drawing.hpp"
+#include "layout.hpp"
+#include "options.hpp"
+#include "svg.hpp"
+
+#include <memory>
+#include <string>
+
+namespace datavis {
+
+// Sink writing a drawing with the given settings in the format of the file
+// extension: ".ppm" and ".png" are rendered by RasterSink
+// (--raster-scale=<pixels per unit>), ".html" is the canvas viewer of
+// HtmlSink, ".dvd" is the record format of BinaryDrawingSink, anything else
+// is SVG streamed by SvgStream. With --tiles[=png|ppm|svg] the path is a
+// directory for WriteTiles (--tile-size=<pixels>).
+std::unique_ptr<DrawingSink> OpenDrawing(const std::string &path, const SvgImage &settings, const Options &options);
+
+// Whether OpenDrawing would write SVG to the path.
+bool IsSvgPath(const std::string &path, const Options &options);
+
+// Whether the path ends in ".dvl" or ".csv", the extensions of OpenLayout.
+bool IsLayoutPath(const std::string &path);
+
+// Layout output instead of a drawing for paths ending in ".dvl" (binary) or
+// ".csv", null for other paths.
+std::unique_ptr<LayoutWriter> OpenLayout(const std::string &path, size_t num_nodes, size_t num_edges);
+
+// Draws the whole image to OpenDrawing(path, image, options); SVG is written
+// by SvgImage::Write, so that symbols stay symbols.
+void SaveImage(const SvgImage &image, const std::string &path, const Options &options);
+
+}  // namespace datavis
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace datavis {
+
+// Number of worker threads to use for a request of `num_threads` (0 means all cores).
+inline int NumThreads(int num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// Calls body(i) for every i in [0, n) on up to `num_threads` threads, handing
+// out indices dynamically. The first exception thrown by `body` is rethrown.
+template <class Body>
+void ParallelFor(size_t n, int num_threads, Body&& body) {
+  auto workers = std::min(static_cast<size_t>(NumThreads(num_threads)), n);
+  if (workers <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      body(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&] {
+    try {
+      for (size_t i; (i = next.fetch_add(1)) < n;) {
+        body(i);
+      }
+    } catch (...) {
+      std::lock_guard lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = n;
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace datavis
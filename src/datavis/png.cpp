@@ -0,0 +1,233 @@
+#include "raster.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace datavis {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t kWindowSize = 1 << 15;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr int kHashBits = 15;
+constexpr size_t kMaxChunkSize = 1 << 20;
+
+constexpr uint16_t kLengthBase[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                      193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                      6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Little-endian bit stream of deflate.
+class BitWriter {
+ public:
+  explicit BitWriter(std::string& out) : out_(out) {
+  }
+
+  void Put(uint32_t bits, int count) {
+    buffer_ |= static_cast<uint64_t>(bits) << count_;
+    count_ += count;
+    while (count_ >= 8) {
+      out_ += static_cast<char>(buffer_);
+      buffer_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  // Huffman codes are stored starting from the most significant bit.
+  void PutCode(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+      reversed |= ((code >> i) & 1) << (length - 1 - i);
+    }
+    Put(reversed, length);
+  }
+
+  void Finish() {
+    if (count_ > 0) {
+      out_ += static_cast<char>(buffer_);
+    }
+    buffer_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  std::string& out_;
+  uint64_t buffer_{0};
+  int count_{0};
+};
+
+// Literal/length symbol in the fixed Huffman code.
+void PutSymbol(BitWriter& bits, int symbol) {
+  if (symbol < 144) {
+    bits.PutCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    bits.PutCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    bits.PutCode(symbol - 256, 7);
+  } else {
+    bits.PutCode(0xC0 + symbol - 280, 8);
+  }
+}
+
+void PutMatch(BitWriter& bits, size_t length, size_t distance) {
+  auto code = std::upper_bound(std::begin(kLengthBase), std::end(kLengthBase), length) - std::begin(kLengthBase) - 1;
+  PutSymbol(bits, 257 + static_cast<int>(code));
+  bits.Put(static_cast<uint32_t>(length - kLengthBase[code]), kLengthExtra[code]);
+  code = std::upper_bound(std::begin(kDistanceBase), std::end(kDistanceBase), distance) - std::begin(kDistanceBase) - 1;
+  bits.PutCode(static_cast<uint32_t>(code), 5);
+  bits.Put(static_cast<uint32_t>(distance - kDistanceBase[code]), kDistanceExtra[code]);
+}
+
+// zlib stream of a single deflate block with fixed Huffman codes. Matches are
+// found through a hash of the next three bytes that remembers the last
+// position only; on rendered images runs and repeated rows dominate, and
+// those are found anyway.
+std::string Compress(std::string_view data) {
+  std::string result = "\x78\x01";
+  BitWriter bits(result);
+  bits.Put(1, 1);  // Final block.
+  bits.Put(1, 2);  // Fixed codes.
+
+  constexpr auto kNone = static_cast<size_t>(-1);
+  std::vector<size_t> head(size_t{1} << kHashBits, kNone);
+  auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  auto hash = [&](size_t i) {
+    uint32_t value = bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16);
+    return (value * 2654435761u) >> (32 - kHashBits);
+  };
+  for (size_t i = 0; i < data.size();) {
+    size_t length = 0;
+    size_t distance = 0;
+    if (i + kMinMatch <= data.size()) {
+      auto& candidate = head[hash(i)];
+      if (candidate != kNone && i - candidate <= kWindowSize) {
+        auto max_length = std::min(kMaxMatch, data.size() - i);
+        while (length < max_length && bytes[candidate + length] == bytes[i + length]) {
+          ++length;
+        }
+        distance = i - candidate;
+      }
+      candidate = i;
+    }
+    if (length < kMinMatch) {
+      PutSymbol(bits, bytes[i++]);
+      continue;
+    }
+    PutMatch(bits, length, distance);
+    for (auto end = i + length; ++i < end;) {
+      if (i + kMinMatch <= data.size()) {
+        head[hash(i)] = i;
+      }
+    }
+  }
+  PutSymbol(bits, 256);
+  bits.Finish();
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    a = (a + bytes[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    result += static_cast<char>((((b << 16) | a) >> shift) & 0xFF);
+  }
+  return result;
+}
+
+uint32_t Crc32(std::string_view data, uint32_t crc = 0) {
+  static const auto kTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (char c : data) {
+    crc = kTable[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void AppendBigEndian(uint32_t value, std::string& out) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out += static_cast<char>((value >> shift) & 0xFF);
+  }
+}
+
+void WriteChunk(std::string_view type, std::string_view data, std::ostream& out) {
+  std::string header;
+  AppendBigEndian(static_cast<uint32_t>(data.size()), header);
+  header += type;
+  std::string crc;
+  AppendBigEndian(Crc32(data, Crc32(type)), crc);
+  out << header << data << crc;
+}
+
+}  // namespace
+
+void WritePng(const Framebuffer& image, std::ostream& out) {
+  // Each row gets the filter, "none" or "up", whose output is closer to
+  // zero; "up" turns rows equal to the previous one into zero runs.
+  size_t row_size = static_cast<size_t>(image.Width()) * 3;
+  std::string filtered;
+  filtered.reserve((row_size + 1) * image.Height());
+  std::string row(row_size, '\0');
+  std::string previous(row_size, '\0');
+  for (int y = 0; y < image.Height(); ++y) {
+    auto* pixels = image.Row(y);
+    for (int x = 0; x < image.Width(); ++x) {
+      row[3 * x] = static_cast<char>(pixels[x]);
+      row[3 * x + 1] = static_cast<char>(pixels[x] >> 8);
+      row[3 * x + 2] = static_cast<char>(pixels[x] >> 16);
+    }
+    uint64_t cost_none = 0;
+    uint64_t cost_up = 0;
+    for (size_t i = 0; i < row_size; ++i) {
+      cost_none += std::abs(static_cast<int8_t>(row[i]));
+      cost_up += std::abs(static_cast<int8_t>(row[i] - previous[i]));
+    }
+    if (cost_up < cost_none) {
+      filtered += '\x02';
+      for (size_t i = 0; i < row_size; ++i) {
+        filtered += static_cast<char>(row[i] - previous[i]);
+      }
+    } else {
+      filtered += '\x00';
+      filtered += row;
+    }
+    row.swap(previous);
+  }
+
+  std::string header;
+  AppendBigEndian(image.Width(), header);
+  AppendBigEndian(image.Height(), header);
+  header += "\x08\x02\x00\x00\x00"sv;  // 8-bit RGB, no interlacing.
+
+  out << "\x89PNG\r\n\x1A\n";
+  WriteChunk("IHDR", header, out);
+  auto compressed = Compress(filtered);
+  for (size_t pos = 0; pos < compressed.size(); pos += kMaxChunkSize) {
+    WriteChunk("IDAT", std::string_view(compressed).substr(pos, kMaxChunkSize), out);
+  }
+  WriteChunk("IEND", {}, out);
+}
+
+}  // namespace datavis
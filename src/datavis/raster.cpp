@@ -0,0 +1,254 @@
+#include "raster.hpp"
+
+#include "common.hpp"
+#include "vector_ops.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <string>
+
+namespace datavis {
+
+namespace {
+
+// Number of pixels with centres before `x`, within [0, size].
+int ClampedCentre(double x, int size) {
+  return std::isnan(x) ? 0 : static_cast<int>(std::clamp(std::ceil(x - 0.5), 0.0, static_cast<double>(size)));
+}
+
+}  // namespace
+
+Framebuffer::Framebuffer(int width, int height, uint32_t color)
+    : width_(width), height_(height), pixels_(static_cast<size_t>(width) * height, color) {
+  VERIFY(width > 0 && height > 0);
+}
+
+void Framebuffer::FillSpan(int y, double x0, double x1, uint32_t color) {
+  if (y < 0 || y >= height_) {
+    return;
+  }
+  auto begin = ClampedCentre(x0, width_);
+  auto end = ClampedCentre(x1, width_);
+  if (begin < end) {
+    std::fill(Row(y) + begin, Row(y) + end, color);
+  }
+}
+
+void Framebuffer::FillRect(double x0, double y0, double x1, double y1, uint32_t color) {
+  for (int y = ClampedCentre(y0, height_), end = ClampedCentre(y1, height_); y < end; ++y) {
+    FillSpan(y, x0, x1, color);
+  }
+}
+
+void Framebuffer::FillDisc(double cx, double cy, double r, uint32_t color) {
+  for (int y = ClampedCentre(cy - r, height_), end = ClampedCentre(cy + r, height_); y < end; ++y) {
+    auto dy = y + 0.5 - cy;
+    auto half = std::sqrt(std::max(0.0, r * r - dy * dy));
+    FillSpan(y, cx - half, cx + half, color);
+  }
+}
+
+void Framebuffer::FillTriangle(SvgImage::Point a, SvgImage::Point b, SvgImage::Point c, uint32_t color) {
+  SvgImage::Point edges[][2] = {{a, b}, {b, c}, {c, a}};
+  auto top = std::min({a.y, b.y, c.y});
+  auto bottom = std::max({a.y, b.y, c.y});
+  for (int y = ClampedCentre(top, height_), end = ClampedCentre(bottom, height_); y < end; ++y) {
+    auto yc = y + 0.5;
+    auto left = std::numeric_limits<double>::infinity();
+    auto right = -left;
+    for (auto [p, q] : edges) {
+      if ((p.y <= yc) != (q.y <= yc)) {
+        auto x = p.x + (yc - p.y) * (q.x - p.x) / (q.y - p.y);
+        left = std::min(left, x);
+        right = std::max(right, x);
+      }
+    }
+    FillSpan(y, left, right, color);
+  }
+}
+
+// Xiaolin Wu's algorithm: each step along the major axis covers the two
+// pixels nearest to the line in proportion to their distance.
+void Framebuffer::DrawLine(SvgImage::Point a, SvgImage::Point b, uint32_t color) {
+  a = {a.x - 0.5, a.y - 0.5};
+  b = {b.x - 0.5, b.y - 0.5};
+  bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+  if (steep) {
+    std::swap(a.x, a.y);
+    std::swap(b.x, b.y);
+  }
+  if (a.x > b.x) {
+    std::swap(a, b);
+  }
+  auto gradient = b.x == a.x ? 0.0 : (b.y - a.y) / (b.x - a.x);
+  int major_size = steep ? height_ : width_;
+  auto begin = std::max(std::round(a.x), 0.0);
+  auto end = std::min(std::round(b.x), major_size - 1.0);
+  for (auto x = static_cast<int>(begin); x <= end; ++x) {
+    auto y = a.y + gradient * (x - a.x);
+    auto floor = std::floor(y);
+    auto fraction = y - floor;
+    auto iy = static_cast<int>(floor);
+    if (steep) {
+      Blend(iy, x, color, 1 - fraction);
+      Blend(iy + 1, x, color, fraction);
+    } else {
+      Blend(x, iy, color, 1 - fraction);
+      Blend(x, iy + 1, color, fraction);
+    }
+  }
+}
+
+void Framebuffer::Blend(int x, int y, uint32_t color, double alpha) {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+    return;
+  }
+  auto& pixel = Row(y)[x];
+  uint32_t result = 0xFF000000u;
+  for (int shift = 0; shift < 24; shift += 8) {
+    double from = (pixel >> shift) & 0xFF;
+    double to = (color >> shift) & 0xFF;
+    result |= static_cast<uint32_t>(std::lround(from + (to - from) * alpha)) << shift;
+  }
+  pixel = result;
+}
+
+namespace {
+
+// Framebuffer for a drawing of `size` SVG units; lowers `pixels_per_unit` to
+// stay within `max_pixels`.
+Framebuffer MakeFramebuffer(SvgImage::Point size, double& pixels_per_unit, size_t max_pixels) {
+  Verify(std::isfinite(size.x) && std::isfinite(size.y), "Nothing to draw");
+  VERIFY(pixels_per_unit > 0);
+  auto area = size.x * size.y * pixels_per_unit * pixels_per_unit;
+  if (area > max_pixels) {
+    pixels_per_unit *= std::sqrt(max_pixels / area);
+  }
+  return Framebuffer(std::max(1, static_cast<int>(std::ceil(size.x * pixels_per_unit))),
+                     std::max(1, static_cast<int>(std::ceil(size.y * pixels_per_unit))));
+}
+
+// Primitives in pixels, k pixels per SVG unit. Strokes are centred on the
+// outline, as in SVG: 1 unit for rects, 0.2 for circles.
+
+void DrawRect(const SvgImage::Rect& rect, double k, SvgImage::Point origin, Framebuffer& target) {
+  auto x0 = rect.p.x * k - origin.x;
+  auto y0 = rect.p.y * k - origin.y;
+  auto x1 = (rect.p.x + rect.len.x) * k - origin.x;
+  auto y1 = (rect.p.y + rect.len.y) * k - origin.y;
+  auto half = 0.5 * k;
+  target.FillRect(x0 - half, y0 - half, x1 + half, y1 + half, kBlack);
+  target.FillRect(x0 + half, y0 + half, x1 - half, y1 - half, kWhite);
+}
+
+void DrawArrowLine(SvgImage::Point a, SvgImage::Point b, bool with_arrow, double k, Framebuffer& target) {
+  target.DrawLine(a, b, kBlack);
+  auto dx = b.x - a.x;
+  auto dy = b.y - a.y;
+  auto length = std::hypot(dx, dy);
+  if (!with_arrow || length == 0) {
+    return;
+  }
+  // The arrowhead of SvgImage::Write: 2 units long and wide, 2 units short of the end.
+  dx *= k / length;
+  dy *= k / length;
+  target.FillTriangle({b.x - 2 * dx, b.y - 2 * dy}, {b.x - 4 * dx - dy, b.y - 4 * dy + dx},
+                      {b.x - 4 * dx + dy, b.y - 4 * dy - dx}, kBlack);
+}
+
+void DrawCircle(SvgImage::Point c, double r, double k, Framebuffer& target) {
+  target.FillDisc(c.x, c.y, (r + 0.1) * k, kBlack);
+  target.FillDisc(c.x, c.y, (r - 0.1) * k, kRed);
+}
+
+void WriteFramebuffer(const Framebuffer& pixels, RasterFormat format, std::ostream& out) {
+  if (format == RasterFormat::kPng) {
+    WritePng(pixels, out);
+  } else {
+    WritePpm(pixels, out);
+  }
+}
+
+}  // namespace
+
+Framebuffer Rasterize(const SvgImage& image, double pixels_per_unit, size_t max_pixels) {
+  auto result = MakeFramebuffer(image.Size(), pixels_per_unit, max_pixels);
+  Draw(image, pixels_per_unit, {0, 0}, result);
+  return result;
+}
+
+void Draw(const SvgImage& image, double pixels_per_unit, SvgImage::Point origin, Framebuffer& target) {
+  auto k = pixels_per_unit;
+  auto to_pixels = [&](const SvgImage::Points& points) {
+    auto result = image.Scaled(points, 0, points.size());
+    ScaleAndShift(result.x.data(), result.size(), k, -origin.x, result.x.data());
+    ScaleAndShift(result.y.data(), result.size(), k, -origin.y, result.y.data());
+    return result;
+  };
+
+  for (size_t i = 0; i < image.rects.size(); ++i) {
+    DrawRect(image.rects[i], k, origin, target);
+  }
+  auto from = to_pixels(image.lines.a);
+  auto to = to_pixels(image.lines.b);
+  for (size_t i = 0; i < image.lines.size(); ++i) {
+    DrawArrowLine(from[i], to[i], image.lines.with_arrow[i], k, target);
+  }
+  auto centres = to_pixels(image.circles.c);
+  for (size_t i = 0; i < image.circles.size(); ++i) {
+    DrawCircle(centres[i], image.circles.r[i], k, target);
+  }
+}
+
+RasterSink::RasterSink(std::ostream& out, RasterFormat format, const SvgImage& settings, double pixels_per_unit,
+                       size_t max_pixels)
+    : out_(out),
+      format_(format),
+      settings_(settings.WithoutPrimitives()),
+      pixels_per_unit_(pixels_per_unit),
+      max_pixels_(max_pixels) {
+}
+
+void RasterSink::Begin(const Box& bounds, bool) {
+  pixels_.emplace(MakeFramebuffer(settings_.Size(bounds), pixels_per_unit_, max_pixels_));
+}
+
+void RasterSink::AddLine(const Line& line) {
+  DrawArrowLine(ToPixels(line.a), ToPixels(line.b), line.with_arrow, pixels_per_unit_, *pixels_);
+}
+
+void RasterSink::AddCircle(const Circle& circle) {
+  DrawCircle(ToPixels(circle.c), circle.r, pixels_per_unit_, *pixels_);
+}
+
+void RasterSink::AddRect(const Rect& rect) {
+  DrawRect(rect, pixels_per_unit_, {0, 0}, *pixels_);
+}
+
+void RasterSink::End() {
+  WriteFramebuffer(*pixels_, format_, out_);
+  out_.flush();
+}
+
+Point RasterSink::ToPixels(Point p) const {
+  return {(settings_.padding + p.x * settings_.scale.x) * pixels_per_unit_,
+          (settings_.padding + p.y * settings_.scale.y) * pixels_per_unit_};
+}
+
+void WritePpm(const Framebuffer& image, std::ostream& out) {
+  out << "P6\n" << image.Width() << ' ' << image.Height() << "\n255\n";
+  std::string row(static_cast<size_t>(image.Width()) * 3, '\0');
+  for (int y = 0; y < image.Height(); ++y) {
+    auto* pixels = image.Row(y);
+    for (int x = 0; x < image.Width(); ++x) {
+      row[3 * x] = static_cast<char>(pixels[x]);
+      row[3 * x + 1] = static_cast<char>(pixels[x] >> 8);
+      row[3 * x + 2] = static_cast<char>(pixels[x] >> 16);
+    }
+    out.write(row.data(), static_cast<std::streamsize>(row.size()));
+  }
+}
+
+}  // namespace datavis
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "svg.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <vector>
+
+namespace datavis {
+
+// Pixel color, 0xAABBGGRR.
+constexpr uint32_t Rgb(uint8_t r, uint8_t g, uint8_t b) {
+  return 0xFF000000u | (uint32_t{b} << 16) | (uint32_t{g} << 8) | r;
+}
+
+constexpr uint32_t kWhite = Rgb(255, 255, 255);
+constexpr uint32_t kBlack = Rgb(0, 0, 0);
+constexpr uint32_t kRed = Rgb(255, 0, 0);
+
+// RGBA framebuffer, rows top to bottom. Pixel (x, y) covers the square
+// [x, x + 1) x [y, y + 1); filled shapes cover the pixels whose centres are
+// inside, lines are antialiased one pixel wide. Everything is clipped to the
+// buffer, so the cost of a shape is the number of pixels it covers.
+class Framebuffer {
+ public:
+  Framebuffer(int width, int height, uint32_t color = kWhite);
+
+  int Width() const {
+    return width_;
+  }
+
+  int Height() const {
+    return height_;
+  }
+
+  uint32_t* Row(int y) {
+    return pixels_.data() + static_cast<size_t>(y) * width_;
+  }
+
+  const uint32_t* Row(int y) const {
+    return pixels_.data() + static_cast<size_t>(y) * width_;
+  }
+
+  // Pixels of row y with centres in [x0, x1).
+  void FillSpan(int y, double x0, double x1, uint32_t color);
+  void FillRect(double x0, double y0, double x1, double y1, uint32_t color);
+  void FillDisc(double cx, double cy, double r, uint32_t color);
+  void FillTriangle(SvgImage::Point a, SvgImage::Point b, SvgImage::Point c, uint32_t color);
+  void DrawLine(SvgImage::Point a, SvgImage::Point b, uint32_t color);
+
+ private:
+  void Blend(int x, int y, uint32_t color, double alpha);
+
+  int width_;
+  int height_;
+  std::vector<uint32_t> pixels_;
+};
+
+// Draws the image as SvgImage::Write lays it out, `pixels_per_unit` pixels per
+// SVG user unit, with the pixel `origin` of the drawing at the top left corner
+// of `target`.
+void Draw(const SvgImage& image, double pixels_per_unit, SvgImage::Point origin, Framebuffer& target);
+
+// Renders the whole image. The ratio is lowered if the result would have
+// more than `max_pixels` pixels.
+Framebuffer Rasterize(const SvgImage& image, double pixels_per_unit = 1, size_t max_pixels = size_t{1} << 26);
+
+enum class RasterFormat { kPpm, kPng };
+
+// Renders primitives as they arrive into a framebuffer of the size that
+// Rasterize would use, and writes it at the end.
+class RasterSink : public DrawingSink {
+ public:
+  RasterSink(std::ostream& out, RasterFormat format, const SvgImage& settings, double pixels_per_unit = 1,
+             size_t max_pixels = size_t{1} << 26);
+
+  void Begin(const Box& bounds, bool with_arrows) override;
+  void AddLine(const Line& line) override;
+  void AddCircle(const Circle& circle) override;
+  void AddRect(const Rect& rect) override;
+  void End() override;
+
+ private:
+  Point ToPixels(Point p) const;
+
+  std::ostream& out_;
+  RasterFormat format_;
+  SvgImage settings_;
+  double pixels_per_unit_;
+  size_t max_pixels_;
+  std::optional<Framebuffer> pixels_;
+};
+
+// Binary PPM (P6).
+void WritePpm(const Framebuffer& image, std::ostream& out);
+
+// 8-bit RGB PNG, compressed by a built-in deflate encoder.
+void WritePng(const Framebuffer& image, std::ostream& out);
+
+}  // namespace datavis
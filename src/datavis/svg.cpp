@@ -1,100 +1,790 @@
 #include "svg.hpp"
 
-#include "pugixml.hpp"
+#include "common.hpp"
+#include "options.hpp"
+#include "parallel.hpp"
+#include "vector_ops.hpp"
 
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace datavis {
 
-void SvgImage::Write(std::ostream& out) const {
-  pugi::xml_document doc;
-  auto svg = doc.append_child("svg");
-  svg.append_attribute("xmlns").set_value("http://www.w3.org/2000/svg");
-  svg.append_attribute("version").set_value("1.0");
-  auto min_x = std::numeric_limits<double>::infinity();
-  auto min_y = min_x;
-  auto max_x = -min_x;
-  auto max_y = -min_y;
-  bool use_arrow = false;
-
-  auto update_minmax = [&](SvgImage::Point p) {
-    min_x = std::min(min_x, p.x);
-    max_x = std::max(max_x, p.x);
-    min_y = std::min(min_y, p.y);
-    max_y = std::max(max_y, p.y);
-  };
+namespace {
+
+constexpr size_t kFlushSize = 1 << 20;
+// Segments or circles per <path> in the compact encoding.
+constexpr size_t kPathBatch = 10000;
+// Elements formatted by one task of the parallel writer.
+constexpr size_t kChunkSize = 1 << 14;
+// Primitives held by SvgStream, whole path batches.
+constexpr size_t kStreamBlock = 16 * kPathBatch;
+
+}  // namespace
+
+// Serializes elements straight into a text buffer that is handed to the
+// stream in large blocks. The layout is the one pugixml's xml_document::save
+// produced: tab indentation, one element per line, numbers as "%.17g" unless
+// another number format is set.
+class SvgWriter {
+ public:
+  SvgWriter(std::ostream& out, SvgImage::NumberFormat format, int decimals)
+      : out_(&out), format_(format), decimals_(decimals), factor_(std::pow(10.0, decimals)) {
+    buffer_.reserve(kFlushSize + 4096);
+  }
+
+  // Writer with the same settings that only collects text, to be added with Append.
+  SvgWriter Part() const {
+    SvgWriter result(format_, decimals_);
+    result.indent_ = indent_;
+    return result;
+  }
+
+  // Extra depth of the elements that follow, e.g. inside a <symbol>.
+  void SetIndent(int indent) {
+    indent_ = indent;
+  }
+
+  void Append(const SvgWriter& part) {
+    buffer_ += part.buffer_;
+    MaybeFlush();
+  }
+
+  void Raw(std::string_view text) {
+    buffer_ += text;
+  }
+
+  void Open(std::string_view name, int depth) {
+    buffer_.append(depth + indent_, '\t');
+    buffer_ += '<';
+    buffer_ += name;
+  }
+
+  void Attribute(std::string_view name, std::string_view value) {
+    AttributeName(name);
+    buffer_ += value;
+    buffer_ += '"';
+  }
+
+  // Coordinate attribute.
+  void Attribute(std::string_view name, double value) {
+    AttributeName(name);
+    Number(value);
+    buffer_ += '"';
+  }
+
+  // Attribute that is not a coordinate, e.g. a stroke width; it is never rounded.
+  void ConstantAttribute(std::string_view name, double value) {
+    AttributeName(name);
+    char text[32];
+    auto result = format_ == SvgImage::NumberFormat::kFull
+                      ? std::to_chars(text, text + sizeof(text), value, std::chars_format::general, 17)
+                      : std::to_chars(text, text + sizeof(text), value);
+    buffer_.append(text, result.ptr);
+    buffer_ += '"';
+  }
+
+  void Attribute(std::string_view name, int value) {
+    AttributeName(name);
+    char text[16];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    buffer_.append(text, result.ptr);
+    buffer_ += '"';
+  }
+
+  // Starts an attribute whose value is written with Raw and Number.
+  void AttributeName(std::string_view name) {
+    buffer_ += ' ';
+    buffer_ += name;
+    buffer_ += "=\"";
+  }
+
+  // Value that is written for a coordinate. Differences of quantized values
+  // are quantized too, so relative path commands do not accumulate error.
+  double Quantize(double value) const {
+    if (format_ != SvgImage::NumberFormat::kFixed) {
+      return value;
+    }
+    value = std::round(value * factor_) / factor_;
+    return value == 0 ? 0 : value;  // No "-0".
+  }
+
+  // Coordinate in the configured format.
+  void Number(double value) {
+    char text[32];
+    buffer_.append(text, FormatNumber(value, text));
+  }
+
+  // Number in path data: leading zeros are dropped and the separator is
+  // omitted before a sign, as the path grammar allows.
+  void PathNumber(double value) {
+    char text[32];
+    std::string_view number(text, FormatNumber(value, text) - text);
+    if (number.substr(0, 2) == "0.") {
+      number.remove_prefix(1);
+    } else if (number.substr(0, 3) == "-0.") {
+      text[1] = '-';
+      number.remove_prefix(1);
+    }
+    auto last = buffer_.empty() ? ' ' : buffer_.back();
+    if (number[0] != '-' && ((last >= '0' && last <= '9') || last == '.')) {
+      buffer_ += ' ';
+    }
+    buffer_ += number;
+  }
+
+  // Ends a start tag of an element with children.
+  void OpenContent() {
+    buffer_ += ">\n";
+  }
+
+  // Ends a start tag of an element without children.
+  void CloseEmpty() {
+    buffer_ += " />\n";
+    MaybeFlush();
+  }
+
+  void MaybeFlush() {
+    if (out_ && buffer_.size() >= kFlushSize) {
+      Flush();
+    }
+  }
+
+  void Close(std::string_view name, int depth) {
+    buffer_.append(depth + indent_, '\t');
+    buffer_ += "</";
+    buffer_ += name;
+    buffer_ += ">\n";
+  }
+
+  void Flush() {
+    out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+
+ private:
+  // Writes the text of a coordinate to `text`, which has room for 31
+  // characters, and returns its end.
+  char* FormatNumber(double value, char* text) const {
+    std::to_chars_result result;
+    switch (format_) {
+      case SvgImage::NumberFormat::kFull:
+        result = std::to_chars(text, text + 31, value, std::chars_format::general, 17);
+        break;
+      case SvgImage::NumberFormat::kShortest:
+        result = std::to_chars(text, text + 31, value);
+        break;
+      case SvgImage::NumberFormat::kFixed:
+        // The rounded value is the double nearest to a multiple of 10^-decimals,
+        // so its shortest fixed notation has at most `decimals` decimals.
+        result = std::to_chars(text, text + 31, Quantize(value), std::chars_format::fixed);
+        break;
+    }
+    return result.ptr;
+  }
+
+  SvgWriter(SvgImage::NumberFormat format, int decimals)
+      : format_(format), decimals_(decimals), factor_(std::pow(10.0, decimals)) {
+  }
+
+  std::ostream* out_{nullptr};
+  SvgImage::NumberFormat format_;
+  int decimals_;
+  double factor_;
+  int indent_{0};
+  std::string buffer_;
+};
+
+namespace {
+
+// Path data of many primitives, split into <path> elements of kPathBatch.
+class PathBatch {
+ public:
+  PathBatch(SvgWriter& svg, std::string_view css_class) : svg_(svg), css_class_(css_class) {
+  }
+
+  // Called before the path data of every primitive; whether it starts a new
+  // <path>, where the current point is the origin.
+  bool Add() {
+    if (size_ == kPathBatch) {
+      Finish();
+    }
+    bool first = size_ == 0;
+    if (first) {
+      svg_.Open("path", 1);
+      svg_.Attribute("class", css_class_);
+      svg_.AttributeName("d");
+    } else {
+      svg_.MaybeFlush();
+    }
+    ++size_;
+    return first;
+  }
+
+  void Finish() {
+    if (size_ > 0) {
+      svg_.Raw("\"");
+      svg_.CloseEmpty();
+      size_ = 0;
+    }
+  }
+
+ private:
+  SvgWriter& svg_;
+  std::string_view css_class_;
+  size_t size_{0};
+};
+
+// Calls write(part, begin, end) for chunks of `chunk_size` of [0, n) on worker
+// threads, each with a part writer of its own, and appends the parts in
+// order; the text is the same as of a single call for [0, n). Chunks are
+// formatted a few per thread at a time to bound the memory.
+template <class Write>
+void WriteChunks(SvgWriter& svg, size_t n, size_t chunk_size, int num_threads, Write&& write) {
+  auto num_chunks = (n + chunk_size - 1) / chunk_size;
+  auto chunks_per_round = static_cast<size_t>(NumThreads(num_threads)) * 4;
+  std::vector<SvgWriter> parts;
+  for (size_t first = 0; first < num_chunks; first += chunks_per_round) {
+    auto count = std::min(chunks_per_round, num_chunks - first);
+    parts.clear();
+    for (size_t i = 0; i < count; ++i) {
+      parts.push_back(svg.Part());
+    }
+    ParallelFor(count, num_threads, [&](size_t i) {
+      auto begin = (first + i) * chunk_size;
+      write(parts[i], begin, std::min(begin + chunk_size, n));
+    });
+    for (const auto& part : parts) {
+      svg.Append(part);
+    }
+  }
+}
+
+// Primitives of each kind are written in chunks on worker threads. In the
+// compact encoding a path chunk is a whole batch, so a <path> never spans two
+// parts.
+
+void WriteRects(const SvgImage& image, SvgWriter& svg) {
+  bool compact = image.encoding == SvgImage::Encoding::kCompact;
+  WriteChunks(svg, image.rects.size(), kChunkSize, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      auto rect = image.rects[i];
+      part.Open("rect", 1);
+      if (compact) {
+        part.Attribute("class", "r");
+      }
+      part.Attribute("x", rect.p.x);
+      part.Attribute("y", rect.p.y);
+      part.Attribute("width", rect.len.x);
+      part.Attribute("height", rect.len.y);
+      if (!compact) {
+        part.Attribute("style", "fill:rgb(255,255,255);stroke-width:1;stroke:rgb(0,0,0)");
+      }
+      part.CloseEmpty();
+    }
+  });
+}
+
+void WriteLineElements(const SvgImage& image, SvgWriter& svg) {
+  WriteChunks(svg, image.lines.size(), kChunkSize, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    auto a = image.Scaled(image.lines.a, begin, end);
+    auto b = image.Scaled(image.lines.b, begin, end);
+    for (auto i = begin; i < end; ++i) {
+      part.Open("line", 1);
+      part.Attribute("x1", a.x[i - begin]);
+      part.Attribute("x2", b.x[i - begin]);
+      part.Attribute("y1", a.y[i - begin]);
+      part.Attribute("y2", b.y[i - begin]);
+      part.ConstantAttribute("stroke-width", 0.1);
+      part.Attribute("stroke", "black");
+      if (image.lines.with_arrow[i]) {
+        part.Attribute("marker-end", "url(#arrowhead)");
+      }
+      part.CloseEmpty();
+    }
+  });
+}
+
+// Path data is relative throughout: every primitive starts with an "m" from
+// the current point, which is the origin at the start of a <path>, and pairs
+// after it are relative line-tos.
+void WriteLinePaths(const SvgImage& image, SvgWriter& svg) {
+  auto padding = image.padding;
+  auto scale = image.scale;
+  WriteChunks(svg, image.lines.size(), kPathBatch, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    auto a = image.Scaled(image.lines.a, begin, end);
+    auto b = image.Scaled(image.lines.b, begin, end);
+    PathBatch edges(part, "e");
+    SvgImage::Point at;
+    for (size_t i = 0; i < end - begin; ++i) {
+      if (edges.Add()) {
+        at = {0, 0};
+      }
+      SvgImage::Point from{part.Quantize(a.x[i]), part.Quantize(a.y[i])};
+      SvgImage::Point to{part.Quantize(b.x[i]), part.Quantize(b.y[i])};
+      part.Raw("m");
+      part.PathNumber(from.x - at.x);
+      part.PathNumber(from.y - at.y);
+      part.PathNumber(to.x - from.x);
+      part.PathNumber(to.y - from.y);
+      at = to;
+    }
+    edges.Finish();
+  });
+
+  // A marker is drawn only at the last vertex of a path, so arrowheads are
+  // triangles of their own, placed where the arrowhead marker would be.
+  std::vector<size_t> arrows;
+  for (size_t i = 0; i < image.lines.size(); ++i) {
+    auto line = image.lines[i];
+    if (line.with_arrow && std::hypot((line.b.x - line.a.x) * scale.x, (line.b.y - line.a.y) * scale.y) != 0) {
+      arrows.push_back(i);
+    }
+  }
+  WriteChunks(svg, arrows.size(), kPathBatch, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    PathBatch heads(part, "h");
+    SvgImage::Point at;
+    for (auto i = begin; i < end; ++i) {
+      auto line = image.lines[arrows[i]];
+      auto dx = (line.b.x - line.a.x) * scale.x;
+      auto dy = (line.b.y - line.a.y) * scale.y;
+      auto length = std::hypot(dx, dy);
+      dx /= length;
+      dy /= length;
+      auto x = padding + line.b.x * scale.x;
+      auto y = padding + line.b.y * scale.y;
+      SvgImage::Point corners[] = {
+          {part.Quantize(x - 2 * dx), part.Quantize(y - 2 * dy)},
+          {part.Quantize(x - 4 * dx - dy), part.Quantize(y - 4 * dy + dx)},
+          {part.Quantize(x - 4 * dx + dy), part.Quantize(y - 4 * dy - dx)},
+      };
+      if (heads.Add()) {
+        at = {0, 0};
+      }
+      part.Raw("m");
+      part.PathNumber(corners[0].x - at.x);
+      part.PathNumber(corners[0].y - at.y);
+      for (int j : {1, 2}) {
+        part.PathNumber(corners[j].x - corners[j - 1].x);
+        part.PathNumber(corners[j].y - corners[j - 1].y);
+      }
+      // Closing returns to the first corner.
+      part.Raw("z");
+      at = corners[0];
+    }
+    heads.Finish();
+  });
+}
 
-  for (auto line : lines) {
-    update_minmax(line.a);
-    update_minmax(line.b);
-    use_arrow |= line.with_arrow;
+void WriteCircleElements(const SvgImage& image, SvgWriter& svg) {
+  WriteChunks(svg, image.circles.size(), kChunkSize, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    auto c = image.Scaled(image.circles.c, begin, end);
+    for (auto i = begin; i < end; ++i) {
+      part.Open("circle", 1);
+      part.Attribute("cx", c.x[i - begin]);
+      part.Attribute("cy", c.y[i - begin]);
+      part.Attribute("r", 2);
+      part.Attribute("fill", "red");
+      part.Attribute("stroke", "black");
+      part.ConstantAttribute("stroke-width", 0.2);
+      part.CloseEmpty();
+    }
+  });
+}
+
+// Circles of a <path> are the "n" marker at its vertices, so the path data is
+// one "m" to the first center and relative line-tos to the others. All
+// circles have the radius of the elements.
+void WriteCirclePaths(const SvgImage& image, SvgWriter& svg) {
+  WriteChunks(svg, image.circles.size(), kPathBatch, image.num_threads, [&](SvgWriter& part, size_t begin, size_t end) {
+    auto c = image.Scaled(image.circles.c, begin, end);
+    PathBatch nodes(part, "v");
+    SvgImage::Point at;
+    for (size_t i = 0; i < end - begin; ++i) {
+      if (nodes.Add()) {
+        part.Raw("m");
+        at = {0, 0};
+      }
+      SvgImage::Point center{part.Quantize(c.x[i]), part.Quantize(c.y[i])};
+      part.PathNumber(center.x - at.x);
+      part.PathNumber(center.y - at.y);
+      at = center;
+    }
+    nodes.Finish();
+  });
+}
+
+void WriteUses(const std::vector<SvgImage::Use>& uses, double padding, SvgImage::Point scale, SvgWriter& svg) {
+  for (const auto& use : uses) {
+    svg.Open("use", 1);
+    svg.Attribute("xlink:href", "#s" + std::to_string(use.symbol));
+    svg.Attribute("x", padding + use.at.x * scale.x);
+    svg.Attribute("y", padding + use.at.y * scale.y);
+    svg.CloseEmpty();
   }
+}
+
+void WritePrimitives(const SvgImage& image, SvgWriter& svg) {
+  bool compact = image.encoding == SvgImage::Encoding::kCompact;
+  WriteRects(image, svg);
+  if (compact) {
+    WriteLinePaths(image, svg);
+  } else {
+    WriteLineElements(image, svg);
+  }
+  WriteUses(image.uses, image.padding, image.scale, svg);
+  if (compact) {
+    WriteCirclePaths(image, svg);
+  } else {
+    WriteCircleElements(image, svg);
+  }
+}
 
-  if (use_arrow) {
+// Symbols are written as images of their own without padding, so their
+// coordinates stay relative to the origin.
+void WriteSymbols(const SvgImage& image, SvgWriter& svg) {
+  if (image.symbols.empty()) {
+    return;
+  }
+  svg.Open("defs", 1);
+  svg.OpenContent();
+  for (size_t i = 0; i < image.symbols.size(); ++i) {
+    const auto& symbol = image.symbols[i];
+    svg.Open("symbol", 2);
+    svg.Attribute("id", "s" + std::to_string(i));
+    svg.Attribute("overflow", "visible");
+    svg.OpenContent();
+    auto part = image.WithoutPrimitives();
+    part.padding = 0;
+    part.lines = symbol.lines;
+    part.circles = symbol.circles;
+    part.uses = symbol.uses;
+    svg.SetIndent(2);
+    WritePrimitives(part, svg);
+    svg.SetIndent(0);
+    svg.Close("symbol", 2);
+  }
+  svg.Close("defs", 1);
+}
+
+// Everything before the primitives; `box` is the extent as of SvgImage::Bounds.
+void WriteHeader(const SvgImage& image, const SvgImage::Box& box, bool use_arrow, SvgWriter& svg) {
+  auto min_x = box.min.x;
+  auto min_y = box.min.y;
+  auto max_x = box.max.x;
+  auto max_y = box.max.y;
+  auto padding = image.padding;
+  auto scale = image.scale;
+  const auto& view = image.view;
+
+  svg.Raw("<?xml version=\"1.0\"?>\n");
+  svg.Open("svg", 0);
+  svg.Attribute("xmlns", "http://www.w3.org/2000/svg");
+  if (!image.symbols.empty()) {
+    svg.Attribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
+  }
+  svg.Attribute("version", "1.0");
+  if (view) {
+    svg.Attribute("width", view->size.x);
+    svg.Attribute("height", view->size.y);
+    svg.AttributeName("viewBox");
+    svg.Number(view->box.min.x);
+    svg.Raw(" ");
+    svg.Number(view->box.min.y);
+    svg.Raw(" ");
+    svg.Number(view->box.max.x - view->box.min.x);
+    svg.Raw(" ");
+    svg.Number(view->box.max.y - view->box.min.y);
+    svg.Raw("\"");
+  } else {
+    svg.Attribute("width", (max_x - min_x) * scale.x + 2 * padding);
+    svg.Attribute("height", (max_y - min_y) * scale.y + 2 * padding);
+  }
+  svg.OpenContent();
+
+  if (use_arrow && image.encoding != SvgImage::Encoding::kCompact) {
     // https://www.thenewcode.com/1068/Making-Arrows-in-SVG
-    auto arrow = svg.append_child("defs").append_child("marker");
-    arrow.append_attribute("id").set_value("arrowhead");
-    arrow.append_attribute("markerWidth").set_value(20);
-    arrow.append_attribute("markerHeight").set_value(20);
-    arrow.append_attribute("refX").set_value(40);
-    arrow.append_attribute("refY").set_value(10);
-    arrow.append_attribute("orient").set_value("auto");
-    auto polygon = arrow.append_child("polygon");
-    polygon.append_attribute("points").set_value("0 0, 20 10, 0 20");
+    svg.Open("defs", 1);
+    svg.OpenContent();
+    svg.Open("marker", 2);
+    svg.Attribute("id", "arrowhead");
+    svg.Attribute("markerWidth", 20);
+    svg.Attribute("markerHeight", 20);
+    svg.Attribute("refX", 40);
+    svg.Attribute("refY", 10);
+    svg.Attribute("orient", "auto");
+    svg.OpenContent();
+    svg.Open("polygon", 3);
+    svg.Attribute("points", "0 0, 20 10, 0 20");
+    svg.CloseEmpty();
+    svg.Close("marker", 2);
+    svg.Close("defs", 1);
   }
 
-  for (auto circle : circles) {
-    update_minmax({circle.c.x, circle.c.y});
+  if (image.encoding == SvgImage::Encoding::kCompact) {
+    svg.Open("style", 1);
+    svg.OpenContent();
+    svg.Raw("\t\t.e{fill:none;stroke:black;stroke-width:0.1}\n"
+            "\t\t.h{fill:black}\n"
+            "\t\t.n{fill:red;stroke:black;stroke-width:0.2}\n"
+            "\t\t.v{fill:none;stroke:none;marker-start:url(#n);marker-mid:url(#n);marker-end:url(#n)}\n"
+            "\t\t.r{fill:rgb(255,255,255);stroke-width:1;stroke:rgb(0,0,0)}\n");
+    svg.Close("style", 1);
+    // The node drawn at every vertex of the "v" paths, in user units.
+    svg.Open("defs", 1);
+    svg.OpenContent();
+    svg.Open("marker", 2);
+    svg.Attribute("id", "n");
+    svg.Attribute("markerUnits", "userSpaceOnUse");
+    svg.Attribute("overflow", "visible");
+    svg.OpenContent();
+    svg.Open("circle", 3);
+    svg.Attribute("class", "n");
+    svg.Attribute("r", 2);
+    svg.CloseEmpty();
+    svg.Close("marker", 2);
+    svg.Close("defs", 1);
   }
 
+  svg.Open("rect", 1);
+  if (view) {
+    svg.Attribute("x", view->box.min.x);
+    svg.Attribute("width", view->box.max.x - view->box.min.x);
+    svg.Attribute("y", view->box.min.y);
+    svg.Attribute("height", view->box.max.y - view->box.min.y);
+  } else {
+    svg.Attribute("x", min_x * scale.x);
+    svg.Attribute("width", (max_x - min_x) * scale.x + padding * 2);
+    svg.Attribute("y", min_y * scale.y);
+    svg.Attribute("height", (max_y - min_y) * scale.y + padding * 2);
+  }
+  svg.Attribute("fill", "white");
+  svg.CloseEmpty();
+}
+
+bool HasArrows(const SvgImage& image) {
+  auto any = [](const SvgImage::Lines& lines) {
+    return std::any_of(lines.with_arrow.begin(), lines.with_arrow.end(), [](uint8_t arrow) { return arrow; });
+  };
+  return any(image.lines) ||
+         std::any_of(image.symbols.begin(), image.symbols.end(), [&](const auto& symbol) { return any(symbol.lines); });
+}
+
+void WriteFooter(SvgWriter& svg) {
+  svg.Close("svg", 0);
+  svg.Flush();
+}
+
+}  // namespace
+
+SvgImage::Box SvgImage::Bounds() const {
   if (fixed_size) {
-    min_x = min_y = 0;
-    max_x = fixed_size->x;
-    max_y = fixed_size->y;
-  }
-
-  auto background = svg.append_child("rect");
-  background.append_attribute("x").set_value(min_x * scale.x);
-  background.append_attribute("width").set_value((max_x - min_x) * scale.x + padding * 2);
-  background.append_attribute("y").set_value(min_y * scale.y);
-  background.append_attribute("height").set_value((max_y - min_y) * scale.y + padding * 2);
-  background.append_attribute("fill").set_value("white");
-
-  for (auto rect : rects) {
-    auto record = svg.append_child("rect");
-    record.append_attribute("x").set_value(rect.p.x);
-    record.append_attribute("y").set_value(rect.p.y);
-    record.append_attribute("width").set_value(rect.len.x);
-    record.append_attribute("height").set_value(rect.len.y);
-    record.append_attribute("style").set_value("fill:rgb(255,255,255);stroke-width:1;stroke:rgb(0,0,0)");
-  }
-
-  for (auto line : lines) {
-    auto record = svg.append_child("line");
-    record.append_attribute("x1").set_value(padding + line.a.x * scale.x);
-    record.append_attribute("x2").set_value(padding + line.b.x * scale.x);
-    record.append_attribute("y1").set_value(padding + line.a.y * scale.y);
-    record.append_attribute("y2").set_value(padding + line.b.y * scale.y);
-    record.append_attribute("stroke-width").set_value(0.1);
-    record.append_attribute("stroke").set_value("black");
-    if (line.with_arrow) {
-      record.append_attribute("marker-end").set_value("url(#arrowhead)");
-    }
-  }
-
-  for (auto circle : circles) {
-    auto record = svg.append_child("circle");
-    record.append_attribute("cx").set_value(padding + circle.c.x * scale.x);
-    record.append_attribute("cy").set_value(padding + circle.c.y * scale.y);
-    record.append_attribute("r").set_value(2);
-    record.append_attribute("fill").set_value("red");
-    record.append_attribute("stroke").set_value("black");
-    record.append_attribute("stroke-width").set_value(0.2);
-  }
-
-  svg.append_attribute("width").set_value((max_x - min_x) * scale.x + 2 * padding);
-  svg.append_attribute("height").set_value((max_y - min_y) * scale.y + 2 * padding);
-  doc.save(out);
+    return {{0, 0}, *fixed_size};
+  }
+  auto inf = std::numeric_limits<double>::infinity();
+  Box box{{inf, inf}, {-inf, -inf}};
+  auto update = [](double& low, double& high, const std::vector<double>& values, double scale = 1,
+                   double offset = 0) {
+    auto [min, max] = MinMax(values.data(), values.size());
+    min = (min - offset) / scale;
+    max = (max - offset) / scale;
+    low = std::min(low, min);
+    high = std::max(high, max);
+  };
+  for (const auto* points : {&lines.a, &lines.b, &circles.c}) {
+    update(box.min.x, box.max.x, points->x);
+    update(box.min.y, box.max.y, points->y);
+  }
+  // Symbols place only symbols before them, so their extents are found in order.
+  auto place = [](Box& target, const Box& symbol, Point at) {
+    target.min = {std::min(target.min.x, symbol.min.x + at.x), std::min(target.min.y, symbol.min.y + at.y)};
+    target.max = {std::max(target.max.x, symbol.max.x + at.x), std::max(target.max.y, symbol.max.y + at.y)};
+  };
+  std::vector<Box> symbol_boxes;
+  for (const auto& symbol : symbols) {
+    Box symbol_box{{inf, inf}, {-inf, -inf}};
+    for (const auto* points : {&symbol.lines.a, &symbol.lines.b, &symbol.circles.c}) {
+      update(symbol_box.min.x, symbol_box.max.x, points->x);
+      update(symbol_box.min.y, symbol_box.max.y, points->y);
+    }
+    for (const auto& use : symbol.uses) {
+      VERIFY(use.symbol < symbol_boxes.size());
+      place(symbol_box, symbol_boxes[use.symbol], use.at);
+    }
+    symbol_boxes.push_back(symbol_box);
+  }
+  for (const auto& use : uses) {
+    VERIFY(use.symbol < symbol_boxes.size());
+    place(box, symbol_boxes[use.symbol], use.at);
+  }
+  // Rects are mapped back to the units of the other primitives.
+  auto update_rects = [&](double& low, double& high, const std::vector<double>& begin,
+                          const std::vector<double>& size, double scale) {
+    std::vector<double> end(begin.size());
+    for (size_t i = 0; i < end.size(); ++i) {
+      end[i] = begin[i] + size[i];
+    }
+    update(low, high, begin, scale, padding);
+    update(low, high, end, scale, padding);
+  };
+  update_rects(box.min.x, box.max.x, rects.p.x, rects.len.x, scale.x);
+  update_rects(box.min.y, box.max.y, rects.p.y, rects.len.y, scale.y);
+  return box;
+}
+
+SvgImage::Points SvgImage::Scaled(const Points& points, size_t begin, size_t end) const {
+  Points result;
+  result.x.resize(end - begin);
+  result.y.resize(end - begin);
+  ScaleAndShift(points.x.data() + begin, end - begin, scale.x, padding, result.x.data());
+  ScaleAndShift(points.y.data() + begin, end - begin, scale.y, padding, result.y.data());
+  return result;
+}
+
+SvgImage::Point SvgImage::Size() const {
+  return Size(Bounds());
+}
+
+SvgImage::Point SvgImage::Size(const Box& box) const {
+  return {(box.max.x - box.min.x) * scale.x + 2 * padding, (box.max.y - box.min.y) * scale.y + 2 * padding};
+}
+
+SvgImage SvgImage::WithoutPrimitives() const {
+  SvgImage result;
+  result.fixed_size = fixed_size;
+  result.view = view;
+  result.padding = padding;
+  result.scale = scale;
+  result.encoding = encoding;
+  result.number_format = number_format;
+  result.decimals = decimals;
+  result.num_threads = num_threads;
+  return result;
+}
+
+void SvgImage::Write(std::ostream& out) const {
+  SvgWriter svg(out, number_format, decimals);
+  WriteHeader(*this, Bounds(), HasArrows(*this), svg);
+  WriteSymbols(*this, svg);
+  WritePrimitives(*this, svg);
+  WriteFooter(svg);
+}
+
+void SvgImage::DrawTo(DrawingSink& sink) const {
+  sink.Begin(Bounds(), HasArrows(*this));
+  for (size_t i = 0; i < rects.size(); ++i) {
+    sink.AddRect(rects[i]);
+  }
+  for (size_t i = 0; i < lines.size(); ++i) {
+    sink.AddLine(lines[i]);
+  }
+  // Placed symbols, expanded with a stack of their own as they may nest deep.
+  struct Frame {
+    const Symbol* symbol;
+    Point at;
+    size_t next_use;
+  };
+  std::vector<Frame> stack;
+  auto open = [&](const Use& use, Point origin) {
+    const auto& symbol = symbols.at(use.symbol);
+    Point at{origin.x + use.at.x, origin.y + use.at.y};
+    for (size_t i = 0; i < symbol.lines.size(); ++i) {
+      auto line = symbol.lines[i];
+      sink.AddLine({{line.a.x + at.x, line.a.y + at.y}, {line.b.x + at.x, line.b.y + at.y}, line.with_arrow});
+    }
+    stack.push_back({&symbol, at, 0});
+  };
+  for (const auto& use : uses) {
+    open(use, {0, 0});
+    while (!stack.empty()) {
+      auto& frame = stack.back();
+      if (frame.next_use < frame.symbol->uses.size()) {
+        auto at = frame.at;
+        open(frame.symbol->uses[frame.next_use++], at);
+        continue;
+      }
+      const auto& symbol_circles = frame.symbol->circles;
+      for (size_t i = 0; i < symbol_circles.size(); ++i) {
+        auto circle = symbol_circles[i];
+        sink.AddCircle({{circle.c.x + frame.at.x, circle.c.y + frame.at.y}, circle.r});
+      }
+      stack.pop_back();
+    }
+  }
+  for (size_t i = 0; i < circles.size(); ++i) {
+    sink.AddCircle(circles[i]);
+  }
+  sink.End();
+}
+
+SvgStream::SvgStream(std::ostream& out, const SvgImage& settings)
+    : pending_(settings.WithoutPrimitives()),
+      writer_(std::make_unique<SvgWriter>(out, settings.number_format, settings.decimals)) {
+}
+
+SvgStream::~SvgStream() = default;
+
+void SvgStream::Begin(const Box& bounds, bool with_arrows) {
+  WriteHeader(pending_, bounds, with_arrows, *writer_);
+}
+
+void SvgStream::AddLine(const Line& line) {
+  if (pending_.lines.size() == kStreamBlock || pending_.rects.size() > 0 || pending_.circles.size() > 0) {
+    Flush();
+  }
+  pending_.lines.push_back(line);
+}
+
+void SvgStream::AddCircle(const Circle& circle) {
+  if (pending_.circles.size() == kStreamBlock || pending_.rects.size() > 0 || pending_.lines.size() > 0) {
+    Flush();
+  }
+  pending_.circles.push_back(circle);
+}
+
+void SvgStream::AddRect(const Rect& rect) {
+  if (pending_.rects.size() == kStreamBlock || pending_.lines.size() > 0 || pending_.circles.size() > 0) {
+    Flush();
+  }
+  pending_.rects.push_back(rect);
+}
+
+void SvgStream::End() {
+  Flush();
+  WriteFooter(*writer_);
+}
+
+void SvgStream::Flush() {
+  WritePrimitives(pending_, *writer_);
+  pending_.lines.clear();
+  pending_.circles.clear();
+  pending_.rects.clear();
+}
+
+void ApplyOptions(const Options& options, SvgImage& image) {
+  if (options.Has("compact")) {
+    image.encoding = SvgImage::Encoding::kCompact;
+    // Rounded, unless --precision says otherwise: full digits would take
+    // most of a compact file.
+    image.number_format = SvgImage::NumberFormat::kFixed;
+  }
+  if (options.Has("precision")) {
+    if (options.Get("precision") == "shortest") {
+      image.number_format = SvgImage::NumberFormat::kShortest;
+    } else {
+      // GetInt rejects a bare --precision too.
+      image.number_format = SvgImage::NumberFormat::kFixed;
+      image.decimals = options.GetInt("precision", image.decimals);
+      Verify(image.decimals >= 0 && image.decimals <= 15, "Bad value of --precision");
+    }
+  }
+  image.num_threads = options.GetInt("threads", image.num_threads);
 }
 
 }
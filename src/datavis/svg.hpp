@@ -1,39 +1,264 @@
+#pragma once
+
+#include "drawing.hpp"
+
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 
 #include <vector>
 #include <optional>
 
 namespace datavis {
 
-struct SvgImage {
-  struct Point {
-    double x, y;
+class Options;
+class SvgWriter;
+
+// Drawing that is kept whole in memory, e.g. to be written by Write. As a
+// sink it collects the primitives it receives.
+struct SvgImage : DrawingSink {
+  using Point = datavis::Point;
+  using Box = datavis::Box;
+  using Line = datavis::Line;
+  using Circle = datavis::Circle;
+  using Rect = datavis::Rect;
+
+  // Primitives are stored as structures of arrays, an array per coordinate,
+  // so that bounds and transforms are loops over contiguous values. Elements
+  // are added and read as the structs above.
+  struct Points {
+    std::vector<double> x, y;
+
+    size_t size() const {
+      return x.size();
+    }
+
+    Point operator[](size_t i) const {
+      return {x[i], y[i]};
+    }
+
+    void push_back(Point p) {
+      x.push_back(p.x);
+      y.push_back(p.y);
+    }
+
+    void reserve(size_t n) {
+      x.reserve(n);
+      y.reserve(n);
+    }
+
+    void clear() {
+      x.clear();
+      y.clear();
+    }
+  };
+
+  struct Lines {
+    Points a, b;
+    std::vector<uint8_t> with_arrow;
+
+    size_t size() const {
+      return a.size();
+    }
+
+    Line operator[](size_t i) const {
+      return {a[i], b[i], with_arrow[i] != 0};
+    }
+
+    void push_back(const Line& line) {
+      a.push_back(line.a);
+      b.push_back(line.b);
+      with_arrow.push_back(line.with_arrow);
+    }
+
+    void reserve(size_t n) {
+      a.reserve(n);
+      b.reserve(n);
+      with_arrow.reserve(n);
+    }
+
+    void clear() {
+      a.clear();
+      b.clear();
+      with_arrow.clear();
+    }
+  };
+
+  struct Circles {
+    Points c;
+    std::vector<double> r;
+
+    size_t size() const {
+      return c.size();
+    }
+
+    Circle operator[](size_t i) const {
+      return {c[i], r[i]};
+    }
+
+    void push_back(const Circle& circle) {
+      c.push_back(circle.c);
+      r.push_back(circle.r);
+    }
+
+    void reserve(size_t n) {
+      c.reserve(n);
+      r.reserve(n);
+    }
+
+    void clear() {
+      c.clear();
+      r.clear();
+    }
+  };
+
+  struct Rects {
+    Points p, len;
+
+    size_t size() const {
+      return p.size();
+    }
+
+    Rect operator[](size_t i) const {
+      return {p[i], len[i]};
+    }
+
+    void push_back(const Rect& rect) {
+      p.push_back(rect.p);
+      len.push_back(rect.len);
+    }
+
+    void reserve(size_t n) {
+      p.reserve(n);
+      len.reserve(n);
+    }
+
+    void clear() {
+      p.clear();
+      len.clear();
+    }
+  };
+
+  enum class Encoding {
+    kElements,  // An element with its own attributes per primitive.
+    // Shared <style> classes; lines, arrowheads and circles batched into a
+    // few <path> elements of relative coordinates, circles being a marker at
+    // the vertices of a path. Much smaller for large drawings.
+    kCompact,
   };
 
-  struct Line {
-    Point a, b;
-    bool with_arrow{true};
+  // Text of coordinates, i.e. of values after scaling.
+  enum class NumberFormat {
+    kFull,      // 17 significant digits, like printf("%.17g").
+    kShortest,  // Shortest text that reads back as the same double.
+    kFixed,     // Rounded to `decimals` digits after the point.
   };
 
-  struct Circle {
-    Point c;
-    double r{2};
+  // Part of the drawing, in SVG units, that is shown at `size`.
+  struct View {
+    Box box;
+    Point size;
   };
 
-  struct Rect {
-    Point p, len;
+  // Placement of symbols[symbol] with its origin at `at`, in the units of
+  // lines and circles.
+  struct Use {
+    size_t symbol;
+    Point at;
+  };
+
+  // Drawing that repeats: Write defines it once as a <symbol> and places it
+  // with <use>, DrawTo sends its primitives at every placement. Coordinates
+  // are relative to its origin. It may place symbols with smaller indices and
+  // draws, like the image, its lines, then its uses, then its circles.
+  struct Symbol {
+    Lines lines;
+    Circles circles;
+    std::vector<Use> uses;
   };
 
   std::optional<Point> fixed_size;
-  std::vector<Line> lines;
-  std::vector<Circle> circles;
-  std::vector<Rect> rects;
+  std::optional<View> view;
+  Lines lines;
+  Circles circles;
+  std::vector<Symbol> symbols;
+  // Drawn after the lines, before the circles.
+  std::vector<Use> uses;
+  // Unlike lines and circles, in SVG units: neither scaled nor padded.
+  Rects rects;
   double padding{5};
   Point scale{10, 20};
+  Encoding encoding{Encoding::kElements};
+  NumberFormat number_format{NumberFormat::kFull};
+  int decimals{2};
+  // Threads that format the elements, 0 for all cores. The output does not
+  // depend on it.
+  int num_threads{0};
+
+  // Extent of all primitives before scaling, or [0, fixed_size].
+  Box Bounds() const;
+
+  // Points [begin, end) in SVG units: padding + p * scale.
+  Points Scaled(const Points& points, size_t begin, size_t end) const;
+
+  // Size of the drawing after scaling and padding, i.e. of the <svg> element.
+  Point Size() const;
+  // The same for primitives with the given bounds.
+  Point Size(const Box& bounds) const;
+
+  // Copy of the settings, i.e. everything but the primitives and symbols.
+  SvgImage WithoutPrimitives() const;
 
   void Write(std::ostream& out) const;
+
+  // Sends the primitives to `sink` in the order in which Write draws them.
+  void DrawTo(DrawingSink& sink) const;
+
+  void Begin(const Box&, bool) override {
+  }
+
+  void AddLine(const Line& line) override {
+    lines.push_back(line);
+  }
+
+  void AddCircle(const Circle& circle) override {
+    circles.push_back(circle);
+  }
+
+  void AddRect(const Rect& rect) override {
+    rects.push_back(rect);
+  }
+
+  void End() override {
+  }
+};
+
+// Writes SVG as primitives arrive, holding a block of them at a time. The
+// text is that of SvgImage::Write with the settings of `settings` if rects,
+// lines and circles come in this order; in the compact encoding arrowheads
+// follow the edges of each block instead of all edges.
+class SvgStream : public DrawingSink {
+ public:
+  SvgStream(std::ostream& out, const SvgImage& settings);
+  ~SvgStream() override;
+
+  void Begin(const Box& bounds, bool with_arrows) override;
+  void AddLine(const Line& line) override;
+  void AddCircle(const Circle& circle) override;
+  void AddRect(const Rect& rect) override;
+  void End() override;
+
+ private:
+  void Flush();
+
+  SvgImage pending_;
+  std::unique_ptr<SvgWriter> writer_;
 };
 
 void WriteSvg(const SvgImage &image, std::ostream &out);
 
+// Drawing options shared by the apps: --compact, --precision=<decimals>|shortest,
+// --threads=<number>. --compact rounds to `decimals` unless --precision is given.
+void ApplyOptions(const Options &options, SvgImage &image);
+
 }  // namespace datavis
@@ -0,0 +1,234 @@
+#include "tiles.hpp"
+
+#include "common.hpp"
+#include "parallel.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace datavis {
+
+namespace {
+
+struct Level {
+  double pixels_per_unit;
+  int width, height;
+  int columns, rows;
+};
+
+// Primitives per tile: tile t draws ids[offsets[t]] .. ids[offsets[t + 1] - 1].
+struct Bins {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> ids;
+};
+
+const char* Extension(TileOptions::Format format) {
+  switch (format) {
+    case TileOptions::Format::kPng:
+      return "png";
+    case TileOptions::Format::kPpm:
+      return "ppm";
+    case TileOptions::Format::kSvg:
+      return "svg";
+  }
+  return "";
+}
+
+// Extent of every primitive in SVG units including strokes and arrowheads:
+// rects first, then lines, then circles.
+std::vector<SvgImage::Box> PrimitiveBoxes(const SvgImage& image) {
+  std::vector<SvgImage::Box> boxes;
+  boxes.reserve(image.rects.size() + image.lines.size() + image.circles.size());
+  for (size_t i = 0; i < image.rects.size(); ++i) {
+    auto rect = image.rects[i];
+    boxes.push_back({{rect.p.x - 0.5, rect.p.y - 0.5}, {rect.p.x + rect.len.x + 0.5, rect.p.y + rect.len.y + 0.5}});
+  }
+  auto from = image.Scaled(image.lines.a, 0, image.lines.size());
+  auto to = image.Scaled(image.lines.b, 0, image.lines.size());
+  for (size_t i = 0; i < image.lines.size(); ++i) {
+    auto a = from[i];
+    auto b = to[i];
+    boxes.push_back({{std::min(a.x, b.x) - 1, std::min(a.y, b.y) - 1}, {std::max(a.x, b.x) + 1, std::max(a.y, b.y) + 1}});
+  }
+  auto centres = image.Scaled(image.circles.c, 0, image.circles.size());
+  for (size_t i = 0; i < image.circles.size(); ++i) {
+    auto c = centres[i];
+    auto r = image.circles.r[i] + 0.1;
+    boxes.push_back({{c.x - r, c.y - r}, {c.x + r, c.y + r}});
+  }
+  return boxes;
+}
+
+// Counting sort of primitives into the tiles their boxes overlap, with a
+// pixel of margin for antialiasing.
+Bins BinPrimitives(const std::vector<SvgImage::Box>& boxes, const Level& level, int tile_size) {
+  auto k = level.pixels_per_unit;
+  auto tile = [&](double pixel, int num_tiles) {
+    return static_cast<int>(std::clamp(std::floor(pixel / tile_size), 0.0, num_tiles - 1.0));
+  };
+  auto for_each_tile = [&](const SvgImage::Box& box, auto&& body) {
+    auto x0 = box.min.x * k - 1;
+    auto y0 = box.min.y * k - 1;
+    auto x1 = box.max.x * k + 1;
+    auto y1 = box.max.y * k + 1;
+    if (x1 < 0 || y1 < 0 || x0 >= level.columns * tile_size || y0 >= level.rows * tile_size) {
+      return;
+    }
+    for (int row = tile(y0, level.rows), last_row = tile(y1, level.rows); row <= last_row; ++row) {
+      for (int column = tile(x0, level.columns), last = tile(x1, level.columns); column <= last; ++column) {
+        body(static_cast<size_t>(row) * level.columns + column);
+      }
+    }
+  };
+
+  Bins bins;
+  bins.offsets.assign(static_cast<size_t>(level.columns) * level.rows + 1, 0);
+  size_t total = 0;
+  for (const auto& box : boxes) {
+    for_each_tile(box, [&](size_t t) {
+      ++bins.offsets[t + 1];
+      ++total;
+    });
+  }
+  Verify(total <= std::numeric_limits<uint32_t>::max(), "Too many primitives per tile level");
+  for (size_t t = 1; t < bins.offsets.size(); ++t) {
+    bins.offsets[t] += bins.offsets[t - 1];
+  }
+  bins.ids.resize(total);
+  auto next = bins.offsets;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    for_each_tile(boxes[i], [&](size_t t) { bins.ids[next[t]++] = static_cast<uint32_t>(i); });
+  }
+  return bins;
+}
+
+void WriteTile(const SvgImage& image, const Level& level, int column, int row, const uint32_t* begin,
+               const uint32_t* end, const TileOptions& options, const std::filesystem::path& path) {
+  SvgImage tile;
+  tile.padding = image.padding;
+  tile.scale = image.scale;
+  tile.encoding = image.encoding;
+  tile.number_format = image.number_format;
+  tile.decimals = image.decimals;
+  tile.num_threads = 1;  // Tiles are already written in parallel.
+  auto num_rects = image.rects.size();
+  auto num_lines = image.lines.size();
+  for (auto* id = begin; id != end; ++id) {
+    if (*id < num_rects) {
+      tile.rects.push_back(image.rects[*id]);
+    } else if (*id < num_rects + num_lines) {
+      tile.lines.push_back(image.lines[*id - num_rects]);
+    } else {
+      tile.circles.push_back(image.circles[*id - num_rects - num_lines]);
+    }
+  }
+
+  auto size = options.tile_size;
+  SvgImage::Point origin{static_cast<double>(column) * size, static_cast<double>(row) * size};
+  std::ofstream out(path, std::ios::binary);
+  Verify(out.is_open(), "Can not open " + path.string());
+  if (options.format == TileOptions::Format::kSvg) {
+    auto k = level.pixels_per_unit;
+    tile.view = SvgImage::View{{{origin.x / k, origin.y / k}, {(origin.x + size) / k, (origin.y + size) / k}},
+                               {static_cast<double>(size), static_cast<double>(size)}};
+    tile.Write(out);
+    return;
+  }
+  Framebuffer pixels(size, size);
+  Draw(tile, level.pixels_per_unit, origin, pixels);
+  if (options.format == TileOptions::Format::kPng) {
+    WritePng(pixels, out);
+  } else {
+    WritePpm(pixels, out);
+  }
+}
+
+}  // namespace
+
+void WriteTiles(const SvgImage& image, const std::string& directory, const TileOptions& options) {
+  auto size = image.Size();
+  Verify(std::isfinite(size.x) && std::isfinite(size.y), "Nothing to draw");
+  VERIFY(options.tile_size > 0 && options.pixels_per_unit > 0);
+  auto tile_size = options.tile_size;
+
+  int num_levels = 1;
+  while (std::max(size.x, size.y) * options.pixels_per_unit > std::ldexp(tile_size, num_levels - 1)) {
+    ++num_levels;
+  }
+  std::vector<Level> levels;
+  for (int z = 0; z < num_levels; ++z) {
+    Level level;
+    level.pixels_per_unit = std::ldexp(options.pixels_per_unit, z - (num_levels - 1));
+    level.width = std::max(1, static_cast<int>(std::ceil(size.x * level.pixels_per_unit)));
+    level.height = std::max(1, static_cast<int>(std::ceil(size.y * level.pixels_per_unit)));
+    level.columns = (level.width + tile_size - 1) / tile_size;
+    level.rows = (level.height + tile_size - 1) / tile_size;
+    levels.push_back(level);
+  }
+
+  std::filesystem::path root(directory);
+  auto boxes = PrimitiveBoxes(image);
+  for (int z = 0; z < num_levels; ++z) {
+    const auto& level = levels[z];
+    auto bins = BinPrimitives(boxes, level, tile_size);
+    auto level_directory = root / std::to_string(z);
+    std::filesystem::create_directories(level_directory);
+    ParallelFor(bins.offsets.size() - 1, options.num_threads, [&](size_t t) {
+      auto begin = bins.offsets[t];
+      auto end = bins.offsets[t + 1];
+      if (begin == end) {
+        return;
+      }
+      int column = static_cast<int>(t % level.columns);
+      int row = static_cast<int>(t / level.columns);
+      auto name = std::to_string(column) + "_" + std::to_string(row) + "." + Extension(options.format);
+      WriteTile(image, level, column, row, bins.ids.data() + begin, bins.ids.data() + end, options,
+                level_directory / name);
+    });
+  }
+
+  std::ofstream manifest(root / "tiles.json");
+  Verify(manifest.is_open(), "Can not write the manifest to " + directory);
+  manifest.precision(17);
+  manifest << "{\n  \"format\": \"" << Extension(options.format) << "\",\n  \"tile_size\": " << tile_size
+           << ",\n  \"levels\": [\n";
+  for (int z = 0; z < num_levels; ++z) {
+    const auto& level = levels[z];
+    manifest << "    {\"pixels_per_unit\": " << level.pixels_per_unit << ", \"width\": " << level.width
+             << ", \"height\": " << level.height << ", \"columns\": " << level.columns
+             << ", \"rows\": " << level.rows << "}" << (z + 1 < num_levels ? ",\n" : "\n");
+  }
+  manifest << "  ]\n}\n";
+}
+
+TileSink::TileSink(std::string directory, const SvgImage& settings, const TileOptions& options)
+    : directory_(std::move(directory)), options_(options), image_(settings.WithoutPrimitives()) {
+}
+
+void TileSink::Begin(const Box&, bool) {
+}
+
+void TileSink::AddLine(const Line& line) {
+  image_.lines.push_back(line);
+}
+
+void TileSink::AddCircle(const Circle& circle) {
+  image_.circles.push_back(circle);
+}
+
+void TileSink::AddRect(const Rect& rect) {
+  image_.rects.push_back(rect);
+}
+
+void TileSink::End() {
+  WriteTiles(image_, directory_, options_);
+}
+
+}  // namespace datavis
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "svg.hpp"
+
+#include <string>
+
+namespace datavis {
+
+struct TileOptions {
+  enum class Format { kPng, kPpm, kSvg };
+
+  Format format{Format::kPng};
+  int tile_size{256};
+  // Resolution of the deepest level.
+  double pixels_per_unit{1};
+  int num_threads{0};
+};
+
+// Deep-zoom pyramid of the image. Level z of L shows the drawing at
+// pixels_per_unit / 2^(L - 1 - z), so level 0 is a single tile, cut into
+// tile_size squares stored as "<directory>/<z>/<column>_<row>.<format>".
+// Tiles without primitives are not written; they are blank. Sizes of the
+// levels are listed in "<directory>/tiles.json".
+void WriteTiles(const SvgImage &image, const std::string &directory, const TileOptions &options);
+
+// Collects the primitives and writes the pyramid at the end; every tile level
+// needs all of them.
+class TileSink : public DrawingSink {
+ public:
+  TileSink(std::string directory, const SvgImage &settings, const TileOptions &options);
+
+  void Begin(const Box &bounds, bool with_arrows) override;
+  void AddLine(const Line &line) override;
+  void AddCircle(const Circle &circle) override;
+  void AddRect(const Rect &rect) override;
+  void End() override;
+
+ private:
+  std::string directory_;
+  TileOptions options_;
+  SvgImage image_;
+};
+
+}  // namespace datavis
@@ -0,0 +1,174 @@
+#include "tree_layout.hpp"
+
+#include "common.hpp"
+
+#include <limits>
+#include <unordered_set>
+
+namespace datavis {
+
+namespace {
+
+constexpr int kNone = -1;
+constexpr double kSpacing = 2;
+
+}  // namespace
+
+TreeLayout::TreeLayout(const Graph& graph, int root)
+    : root_(root),
+      parent_(graph.num_nodes, kNone),
+      index_(graph.num_nodes, 0),
+      depth_(graph.num_nodes, 0),
+      width_(graph.num_nodes, 0),
+      offset_(graph.num_nodes, 0),
+      removed_(graph.num_nodes, 1),
+      children_(graph.num_nodes) {
+  VERIFY(root >= 0 && root < graph.num_nodes);
+  // Nodes outside the tree stay removed.
+  removed_[root] = 0;
+  std::vector<int> order{root};
+  for (size_t i = 0; i < order.size(); ++i) {
+    int v = order[i];
+    for (int child : graph.out[v]) {
+      // Nodes not reached yet are still marked removed.
+      Verify(removed_[child], "The graph is not a tree");
+      parent_[child] = v;
+      depth_[child] = depth_[v] + 1;
+      removed_[child] = 0;
+      children_[v].push_back(child);
+      order.push_back(child);
+    }
+  }
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    Arrange(*it, 0);
+  }
+}
+
+bool TreeLayout::Contains(int v) const {
+  return v >= 0 && v < NumIds() && !removed_[v];
+}
+
+int TreeLayout::Insert(int parent, size_t index, const Graph& graph, int root) {
+  VERIFY(Contains(parent) && index <= children_[parent].size());
+  int v = Copy(graph, root, parent, depth_[parent] + 1);
+  auto& siblings = children_[parent];
+  siblings.insert(siblings.begin() + index, v);
+  Update(parent, index);
+  return v;
+}
+
+void TreeLayout::Remove(int v) {
+  VERIFY(Contains(v) && v != root_);
+  int p = parent_[v];
+  size_t index = index_[v];
+  auto& siblings = children_[p];
+  siblings.erase(siblings.begin() + index);
+  std::vector<int> stack{v};
+  while (!stack.empty()) {
+    int u = stack.back();
+    stack.pop_back();
+    removed_[u] = 1;
+    for (int child : children_[u]) {
+      stack.push_back(child);
+    }
+    children_[u].clear();
+    children_[u].shrink_to_fit();
+  }
+  Update(p, index);
+}
+
+Point TreeLayout::Position(int v) const {
+  VERIFY(Contains(v));
+  auto x = width_[v] / 2;
+  for (int u = v; u != kNone; u = parent_[u]) {
+    x += offset_[u];
+  }
+  return {x, static_cast<double>(depth_[v])};
+}
+
+std::vector<Point> TreeLayout::Positions() const {
+  auto nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<Point> result(parent_.size(), {nan, nan});
+  // Left edges of the subtrees, parents before children.
+  std::vector<double> left(parent_.size());
+  std::vector<int> stack{root_};
+  while (!stack.empty()) {
+    int v = stack.back();
+    stack.pop_back();
+    left[v] = offset_[v] + (v == root_ ? 0 : left[parent_[v]]);
+    result[v] = {left[v] + width_[v] / 2, static_cast<double>(depth_[v])};
+    for (int child : children_[v]) {
+      stack.push_back(child);
+    }
+  }
+  return result;
+}
+
+int TreeLayout::Copy(const Graph& graph, int root, int parent, int depth) {
+  VERIFY(root >= 0 && root < graph.num_nodes);
+  // Breadth-first, so that children get larger ids than their parents and
+  // widths can be found in the reverse order of the ids. The tree is checked
+  // before anything is added, so a bad one leaves the layout as it was.
+  std::vector<int> order{root};
+  std::unordered_set<int> seen{root};
+  for (size_t i = 0; i < order.size(); ++i) {
+    for (int child : graph.out[order[i]]) {
+      Verify(seen.insert(child).second, "The graph is not a tree");
+      order.push_back(child);
+    }
+  }
+
+  auto first = NumIds();
+  auto add = [&](int copy_parent, int copy_depth) {
+    parent_.push_back(copy_parent);
+    index_.push_back(0);
+    depth_.push_back(copy_depth);
+    width_.push_back(0);
+    offset_.push_back(0);
+    removed_.push_back(0);
+    children_.emplace_back();
+  };
+  add(parent, depth);
+  for (size_t i = 0; i < order.size(); ++i) {
+    int copy = first + static_cast<int>(i);
+    for (size_t j = 0; j < graph.out.Degree(order[i]); ++j) {
+      children_[copy].push_back(NumIds());
+      add(copy, depth_[copy] + 1);
+    }
+  }
+  for (int v = NumIds() - 1; v >= first; --v) {
+    Arrange(v, 0);
+  }
+  return first;
+}
+
+void TreeLayout::Update(int p, size_t first) {
+  while (true) {
+    auto width = width_[p];
+    Arrange(p, first);
+    if (width_[p] == width || parent_[p] == kNone) {
+      return;
+    }
+    // Siblings after p move; p itself stays.
+    first = index_[p] + 1;
+    p = parent_[p];
+  }
+}
+
+void TreeLayout::Arrange(int p, size_t first) {
+  const auto& children = children_[p];
+  double next = 0;
+  if (first > 0) {
+    int previous = children[first - 1];
+    next = offset_[previous] + width_[previous] + kSpacing;
+  }
+  for (auto i = first; i < children.size(); ++i) {
+    int child = children[i];
+    index_[child] = static_cast<uint32_t>(i);
+    offset_[child] = next;
+    next += width_[child] + kSpacing;
+  }
+  width_[p] = children.empty() ? 0 : next - kSpacing;
+}
+
+}  // namespace datavis
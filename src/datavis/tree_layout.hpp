@@ -0,0 +1,78 @@
+#pragma once
+
+#include "drawing.hpp"
+#include "graph.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace datavis {
+
+// Layout of vis-tree's default placement that is kept up to date under
+// subtree insertions and removals. Leaves are 2 units apart in DFS order and
+// every node is centred over the leaves of its subtree, at its depth.
+//
+// Every node keeps the width of its subtree and the offset of its subtree
+// from the left edge of its parent's, so an edit recomputes only the widths
+// of its ancestors and the offsets of their later siblings, and a position is
+// a sum over the path to the root.
+class TreeLayout {
+ public:
+  // Layout of the tree of `graph` hanging from `root`; node ids are those of
+  // the graph, nodes outside the tree count as removed. Fails if what hangs
+  // from `root` is not a tree.
+  TreeLayout(const Graph &graph, int root);
+
+  int Root() const {
+    return root_;
+  }
+
+  // Whether node v exists, i.e. was not removed.
+  bool Contains(int v) const;
+
+  // Adds a copy of the tree of `graph` hanging from `root` as child number
+  // `index` of `parent`. Its nodes get new ids, breadth-first, the first being
+  // the returned id of its root. Fails, changing nothing, if what hangs from
+  // `root` is not a tree.
+  int Insert(int parent, size_t index, const Graph &graph, int root);
+
+  // Removes v and its subtree; v must not be the root. Ids are not reused.
+  void Remove(int v);
+
+  // O(depth).
+  Point Position(int v) const;
+
+  // Positions indexed by id, NaN for removed nodes. O(number of ids).
+  std::vector<Point> Positions() const;
+
+  // Children of v in order.
+  const std::vector<int> &Children(int v) const {
+    return children_[v];
+  }
+
+  // Number of ids ever given, including removed nodes.
+  int NumIds() const {
+    return static_cast<int>(parent_.size());
+  }
+
+ private:
+  // Appends the tree of `graph` hanging from `root` as a child of `parent`,
+  // without linking it; returns its id.
+  int Copy(const Graph &graph, int root, int parent, int depth);
+  // Arrange(p, first), then the later siblings of every ancestor whose width
+  // changed.
+  void Update(int p, size_t first);
+  // Offsets of children [first, end) of p and the width of p.
+  void Arrange(int p, size_t first);
+
+  int root_;
+  std::vector<int> parent_;
+  std::vector<uint32_t> index_;  // Among the siblings.
+  std::vector<int> depth_;
+  std::vector<double> width_;   // From the leftmost to the rightmost leaf.
+  std::vector<double> offset_;  // From the leftmost leaf of the parent.
+  std::vector<uint8_t> removed_;
+  std::vector<std::vector<int>> children_;
+};
+
+}  // namespace datavis
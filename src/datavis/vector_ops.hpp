@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace datavis {
+
+// Kernels over plain arrays, written with independent lanes and without
+// branches so that compilers turn them into SIMD code.
+
+constexpr size_t kLanes = 8;
+
+// {min, max} of values[0, n); {inf, -inf} if there are none. NaNs are
+// skipped, as by std::min and std::max with the running value first.
+inline std::pair<double, double> MinMax(const double* values, size_t n) {
+  double low[kLanes];
+  double high[kLanes];
+  for (size_t j = 0; j < kLanes; ++j) {
+    low[j] = std::numeric_limits<double>::infinity();
+    high[j] = -std::numeric_limits<double>::infinity();
+  }
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    for (size_t j = 0; j < kLanes; ++j) {
+      auto value = values[i + j];
+      low[j] = value < low[j] ? value : low[j];
+      high[j] = high[j] < value ? value : high[j];
+    }
+  }
+  for (size_t j = 0; i < n; ++i, ++j) {
+    auto value = values[i];
+    low[j] = value < low[j] ? value : low[j];
+    high[j] = high[j] < value ? value : high[j];
+  }
+  for (size_t j = 1; j < kLanes; ++j) {
+    low[0] = low[j] < low[0] ? low[j] : low[0];
+    high[0] = high[0] < high[j] ? high[j] : high[0];
+  }
+  return {low[0], high[0]};
+}
+
+// out[i] = offset + values[i] * scale for i in [0, n); `out` may be `values`.
+inline void ScaleAndShift(const double* values, size_t n, double scale, double offset, double* out) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = offset + values[i] * scale;
+  }
+}
+
+}  // namespace datavis
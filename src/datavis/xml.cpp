@@ -0,0 +1,318 @@
+#include "xml.hpp"
+
+#include "common.hpp"
+
+#include <cstring>
+#include <istream>
+
+namespace datavis {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t kBlockSize = 1 << 20;
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool IsNameEnd(char c) {
+  return IsSpace(c) || c == '>' || c == '/' || c == '=';
+}
+
+const char* SkipSpaces(const char* p, const char* end) {
+  while (p != end && IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+const char* SkipName(const char* p, const char* end) {
+  while (p != end && !IsNameEnd(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// Position right after the first occurrence of `terminator`, nullptr if there is none yet.
+const char* SkipPast(const char* p, const char* end, std::string_view terminator) {
+  auto pos = std::string_view(p, end - p).find(terminator);
+  return pos == std::string_view::npos ? nullptr : p + pos + terminator.size();
+}
+
+// Skips <!DOCTYPE ...> including an internal subset in square brackets.
+const char* SkipDoctype(const char* p, const char* end) {
+  int depth = 0;
+  char quote = 0;
+  for (; p != end; ++p) {
+    if (quote) {
+      quote = *p == quote ? 0 : quote;
+    } else if (*p == '"' || *p == '\'') {
+      quote = *p;
+    } else if (*p == '[') {
+      ++depth;
+    } else if (*p == ']') {
+      --depth;
+    } else if (*p == '>' && depth == 0) {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+bool NeedsDecoding(std::string_view value) {
+  for (char c : value) {
+    if (c == '&' || c == '\t' || c == '\n' || c == '\r') {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendUtf8(unsigned long code, std::string& out) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xC0 | (code >> 6));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    out += static_cast<char>(0xE0 | (code >> 12));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (code >> 18));
+    out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (code & 0x3F));
+  }
+}
+
+// Expands entity references and turns whitespace into spaces, as pugixml does
+// for attribute values by default. Unknown entities are kept as is.
+void AppendDecoded(std::string_view value, std::string& out) {
+  for (size_t i = 0; i < value.size(); ++i) {
+    char c = value[i];
+    if (c == '\r' || c == '\n' || c == '\t') {
+      if (c == '\r' && i + 1 < value.size() && value[i + 1] == '\n') {
+        ++i;
+      }
+      out += ' ';
+      continue;
+    }
+    auto semicolon = c == '&' ? value.find(';', i) : std::string_view::npos;
+    if (semicolon == std::string_view::npos) {
+      out += c;
+      continue;
+    }
+    auto entity = value.substr(i + 1, semicolon - i - 1);
+    if (entity == "lt"sv) {
+      out += '<';
+    } else if (entity == "gt"sv) {
+      out += '>';
+    } else if (entity == "amp"sv) {
+      out += '&';
+    } else if (entity == "quot"sv) {
+      out += '"';
+    } else if (entity == "apos"sv) {
+      out += '\'';
+    } else if (entity.size() > 1 && entity[0] == '#') {
+      bool hex = entity[1] == 'x';
+      std::string digits(entity.substr(hex ? 2 : 1));
+      char* digits_end = nullptr;
+      auto code = std::strtoul(digits.c_str(), &digits_end, hex ? 16 : 10);
+      VERIFY(!digits.empty() && *digits_end == 0 && code <= 0x10FFFF);
+      AppendUtf8(code, out);
+    } else {
+      out += c;
+      continue;
+    }
+    i = semicolon;
+  }
+}
+
+}  // namespace
+
+std::string_view XmlTag::Attribute(std::string_view attribute_name) const {
+  for (const auto& attribute : attributes) {
+    if (attribute.name == attribute_name) {
+      return attribute.value;
+    }
+  }
+  return {};
+}
+
+XmlReader::XmlReader(std::istream& in) : in_(&in), buffer_(kBlockSize) {
+  pos_ = end_ = buffer_.data();
+}
+
+XmlReader::XmlReader(const char* begin, const char* end) : begin_(begin), pos_(begin), end_(end) {
+}
+
+bool XmlReader::Next(XmlTag& tag) {
+  while (true) {
+    auto status = Scan(tag);
+    if (status == Status::kTag) {
+      return true;
+    }
+    if (!Refill()) {
+      Verify(status == Status::kEnd, "Unexpected end of XML input");
+      return false;
+    }
+  }
+}
+
+bool XmlReader::IsPersistent(std::string_view value) const {
+  return !in_ && value.data() >= begin_ && value.data() + value.size() <= end_;
+}
+
+std::string_view XmlReader::Remaining() const {
+  return in_ ? std::string_view() : std::string_view(pos_, end_ - pos_);
+}
+
+XmlReader::Status XmlReader::Scan(XmlTag& tag) {
+  while (true) {
+    auto* p = static_cast<const char*>(std::memchr(pos_, '<', end_ - pos_));
+    if (!p) {
+      pos_ = end_;
+      return Status::kEnd;
+    }
+    // Markup that is cut by the end of the buffer is rescanned from here.
+    pos_ = p;
+    if (end_ - p < 4) {
+      return Status::kNeedMore;
+    }
+
+    if (p[1] == '?') {
+      auto* next = SkipPast(p + 2, end_, "?>");
+      if (!next) {
+        return Status::kNeedMore;
+      }
+      pos_ = next;
+      continue;
+    }
+    if (p[1] == '!') {
+      const char* next;
+      if (p[2] == '-' && p[3] == '-') {
+        next = SkipPast(p + 4, end_, "-->");
+      } else if (p[2] == '[') {
+        if (end_ - p < 9) {
+          return Status::kNeedMore;
+        }
+        VERIFY(std::string_view(p, 9) == "<![CDATA["sv);
+        next = SkipPast(p + 9, end_, "]]>");
+      } else {
+        next = SkipDoctype(p + 2, end_);
+      }
+      if (!next) {
+        return Status::kNeedMore;
+      }
+      pos_ = next;
+      continue;
+    }
+
+    tag.attributes.clear();
+    if (p[1] == '/') {
+      auto* name_end = SkipName(p + 2, end_);
+      auto* q = SkipSpaces(name_end, end_);
+      if (q == end_) {
+        return Status::kNeedMore;
+      }
+      VERIFY(name_end != p + 2 && *q == '>');
+      tag.kind = XmlTag::Kind::kClose;
+      tag.name = std::string_view(p + 2, name_end - p - 2);
+      pos_ = q + 1;
+      return Status::kTag;
+    }
+
+    auto* q = SkipName(p + 1, end_);
+    if (q == end_) {
+      return Status::kNeedMore;
+    }
+    VERIFY(q != p + 1);
+    tag.name = std::string_view(p + 1, q - p - 1);
+    bool need_decoding = false;
+    while (true) {
+      q = SkipSpaces(q, end_);
+      if (q == end_) {
+        return Status::kNeedMore;
+      }
+      if (*q == '>') {
+        tag.kind = XmlTag::Kind::kOpen;
+        ++q;
+        break;
+      }
+      if (*q == '/') {
+        if (q + 1 == end_) {
+          return Status::kNeedMore;
+        }
+        VERIFY(q[1] == '>');
+        tag.kind = XmlTag::Kind::kEmpty;
+        q += 2;
+        break;
+      }
+      auto* name_begin = q;
+      q = SkipName(q, end_);
+      auto* name_end = q;
+      q = SkipSpaces(q, end_);
+      if (q == end_) {
+        return Status::kNeedMore;
+      }
+      VERIFY(name_end != name_begin && *q == '=');
+      q = SkipSpaces(q + 1, end_);
+      if (q == end_) {
+        return Status::kNeedMore;
+      }
+      char quote = *q++;
+      VERIFY(quote == '"' || quote == '\'');
+      auto* value_end = static_cast<const char*>(std::memchr(q, quote, end_ - q));
+      if (!value_end) {
+        return Status::kNeedMore;
+      }
+      std::string_view value(q, value_end - q);
+      need_decoding |= NeedsDecoding(value);
+      tag.attributes.push_back({std::string_view(name_begin, name_end - name_begin), value});
+      q = value_end + 1;
+    }
+
+    if (need_decoding) {
+      // Decoded values are never longer than raw ones, so after this reserve
+      // the views into `storage` are not invalidated by appends.
+      size_t total_size = 0;
+      for (const auto& attribute : tag.attributes) {
+        total_size += attribute.value.size();
+      }
+      tag.storage.clear();
+      tag.storage.reserve(total_size);
+      for (auto& attribute : tag.attributes) {
+        if (NeedsDecoding(attribute.value)) {
+          auto offset = tag.storage.size();
+          AppendDecoded(attribute.value, tag.storage);
+          attribute.value = std::string_view(tag.storage).substr(offset);
+        }
+      }
+    }
+    pos_ = q;
+    return Status::kTag;
+  }
+}
+
+bool XmlReader::Refill() {
+  if (!in_) {
+    return false;
+  }
+  size_t offset = pos_ - buffer_.data();
+  size_t keep = end_ - pos_;
+  std::memmove(buffer_.data(), buffer_.data() + offset, keep);
+  if (keep == buffer_.size()) {
+    // A single piece of markup does not fit into the buffer.
+    buffer_.resize(buffer_.size() * 2);
+  }
+  in_->read(buffer_.data() + keep, static_cast<std::streamsize>(buffer_.size() - keep));
+  auto size = static_cast<size_t>(in_->gcount());
+  pos_ = buffer_.data();
+  end_ = pos_ + keep + size;
+  return size != 0;
+}
+
+}  // namespace datavis
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace datavis {
+
+struct XmlAttribute {
+  std::string_view name;
+  std::string_view value;
+};
+
+// Element tag as reported by XmlReader. Views point either into the reader's
+// buffer or into `storage` (for values with entity references) and stay valid
+// until the next call to XmlReader::Next.
+struct XmlTag {
+  enum class Kind {
+    kOpen,   // <name ...>
+    kClose,  // </name>
+    kEmpty,  // <name .../>
+  };
+
+  Kind kind;
+  std::string_view name;
+  std::vector<XmlAttribute> attributes;
+  std::string storage;
+
+  // Empty view if there is no such attribute, like pugi::xml_attribute::value.
+  std::string_view Attribute(std::string_view attribute_name) const;
+};
+
+// Forward-only, event-driven XML reader. Only element tags are reported; text,
+// comments, CDATA sections, processing instructions and the doctype are
+// skipped. Memory use is bounded by the largest single tag, not by the input.
+class XmlReader {
+ public:
+  // Reads the stream block by block.
+  explicit XmlReader(std::istream& in);
+
+  // Reads a document that is already in memory; tags are views into it.
+  XmlReader(const char* begin, const char* end);
+
+  // Returns false at the end of input.
+  bool Next(XmlTag& tag);
+
+  // True if `value` is a view into an in-memory document, i.e. it outlives
+  // the tag it came from.
+  bool IsPersistent(std::string_view value) const;
+
+  // Unread part of an in-memory document, empty for streams.
+  std::string_view Remaining() const;
+
+ private:
+  enum class Status { kTag, kNeedMore, kEnd };
+
+  Status Scan(XmlTag& tag);
+  bool Refill();
+
+  std::istream* in_{nullptr};
+  std::vector<char> buffer_;
+  const char* begin_{nullptr};
+  const char* pos_{nullptr};
+  const char* end_{nullptr};
+};
+
+}  // namespace datavis